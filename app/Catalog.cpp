@@ -43,6 +43,29 @@ unsigned int getTexture(TextureCatalog& catalog, const std::string& name)
     return catalog[name];
 }
 
+TextureArrays createTextureArrays(const std::filesystem::path& location, const std::vector<std::string>& names, TEXTURE_FILTER filter)
+{
+    std::cerr << "\nBuilding texture arrays of " << names.size() << " images from " << location << std::endl;
+    std::vector<std::string> paths;
+    for (auto& name : names)
+    {
+        paths.push_back((location / name).string());
+    }
+    TextureArrays textureArrays;
+    std::vector<TextureArrayLayer> layers;
+    if (!loadTextureArrays(paths, textureArrays.textures, layers, filter))
+    {
+        std::cerr << "Failed to build texture arrays" << std::endl;
+        return textureArrays;
+    }
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        textureArrays.layers[names[i]] = layers[i];
+    }
+    std::cerr << "Done building " << textureArrays.textures.size() << " texture arrays " << location << std::endl;
+    return textureArrays;
+}
+
 using AnimationCatalog = std::map<std::string, AnimationSequence>;
 
 AnimationCatalog createAnimationCatalog(const std::filesystem::path& location)
@@ -98,6 +121,10 @@ AnimationCatalog createAnimationCatalog(const std::filesystem::path& location)
 
 AnimationSequence& getAnimation(AnimationCatalog& catalog, const std::string name)
 {
+    // Lookups of known animations do not modify the catalog, animations are updated in parallel
+    auto animation = catalog.find(name);
+    if (animation != catalog.end())
+        return animation->second;
     #ifndef NDEBUG
     if (not catalog.contains(name))
         std::cerr << "Catalog does not contain " << name << std::endl;
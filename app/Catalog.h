@@ -12,5 +12,8 @@ using AnimationCatalog = std::map<std::string, AnimationSequence>;
 TextureCatalog createTextureCatalog(const std::filesystem::path& location, TEXTURE_FILTER filter);
 unsigned int getTexture(TextureCatalog& catalog, const std::string& name);
 
+/// Loads the named images below location into texture arrays, one per image size
+TextureArrays createTextureArrays(const std::filesystem::path& location, const std::vector<std::string>& names, TEXTURE_FILTER filter);
+
 AnimationCatalog createAnimationCatalog(const std::filesystem::path& location);
 AnimationSequence& getAnimation(AnimationCatalog& catalog, const std::string name);
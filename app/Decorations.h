@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+enum class DecoType
+{
+    WOOD = 0,
+    GLAZE,
+    FLOWER,
+    OVEN,
+    BRIDGE_HOR,
+    BRIDGE_VER
+};
+
+/// Number of decoration types, BRIDGE_VER is the last one
+constexpr uint32_t DecoTypeCount = static_cast<uint32_t>(DecoType::BRIDGE_VER) + 1;
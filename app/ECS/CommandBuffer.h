@@ -0,0 +1,87 @@
+#ifndef ECS_COMMANDBUFFER_H
+#define ECS_COMMANDBUFFER_H
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+
+#include "ECS/ECS.h"
+
+/// Records structural changes made while iterating a view or group and applies them at a sync point.
+/// Component inserts and removals run in recorded order, entity removals follow as one sorted batch.
+/// Commands on entities that were removed by the time they apply are skipped.
+class CommandBuffer
+{
+public:
+    /// Creating an entity does not move any component, so it happens right away and the handle can be used in later commands
+    Entity create(Registry &registry)
+    {
+        return registry.create();
+    }
+
+    template <typename T>
+    void insert(Entity entity, const T &component)
+    {
+        m_componentCommands.push_back([entity, component](Registry &registry)
+                                      {
+                                          if (registry.valid(entity))
+                                          {
+                                              registry.insert_or_replace<T>(entity, component);
+                                          }
+                                      });
+    }
+
+    template <typename T>
+    void remove(Entity entity)
+    {
+        m_componentCommands.push_back([entity](Registry &registry)
+                                      {
+                                          if (registry.valid(entity))
+                                          {
+                                              registry.remove<T>(entity);
+                                          }
+                                      });
+    }
+
+    void remove(Entity entity)
+    {
+        m_removals.push_back(entity);
+    }
+
+    /// Moves the commands of other behind the commands already recorded
+    void append(CommandBuffer &&other)
+    {
+        std::move(other.m_componentCommands.begin(), other.m_componentCommands.end(), std::back_inserter(m_componentCommands));
+        m_removals.insert(m_removals.end(), other.m_removals.begin(), other.m_removals.end());
+        other.m_componentCommands.clear();
+        other.m_removals.clear();
+    }
+
+    bool empty() const
+    {
+        return m_componentCommands.empty() && m_removals.empty();
+    }
+
+    void apply(Registry &registry)
+    {
+        for (auto &command : m_componentCommands)
+        {
+            command(registry);
+        }
+        m_componentCommands.clear();
+
+        // Sorted by slot and then by the whole handle, so duplicates are adjacent for unique
+        std::sort(m_removals.begin(), m_removals.end(), [](Entity a, Entity b)
+                  { return entityIndex(a) != entityIndex(b) ? entityIndex(a) < entityIndex(b) : a < b; });
+        m_removals.erase(std::unique(m_removals.begin(), m_removals.end()), m_removals.end());
+        registry.remove(m_removals);
+        m_removals.clear();
+    }
+
+private:
+    std::vector<std::function<void(Registry &)>> m_componentCommands;
+    std::vector<Entity> m_removals;
+};
+
+#endif
@@ -11,42 +11,182 @@
 #include <tuple>
 #include <functional>
 #include <algorithm>
+#include <memory>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <cstdlib>
+#include <bitset>
+#include <bit>
+#include <span>
+#include <array>
+#include <atomic>
+#include <mutex>
 
 #define DEBUGGING false
 
-using Entity = uint32_t;
-static inline Entity MaxEntities = 100'000;
+/// Entity handles pack a slot index in the low EntityIndexBits bits and a generation in the high bits.
+/// The generation is bumped when the slot is recycled, so handles to removed entities can be detected.
+/// Slot 0 is never handed out, a zero handle means no entity.
+/// 32 index bits put the ceiling at 2^32 - 1 live slots, far beyond the maps the game loads. Past it create
+/// reports the failure and returns the zero handle. 32 generation bits keep stale handles detectable for
+/// 2^32 reuses of a slot.
+using Entity = uint64_t;
+
+static constexpr Entity EntityIndexBits = 32;
+static constexpr Entity EntityIndexMask = (Entity{1} << EntityIndexBits) - 1;
+static constexpr Entity EntityVersionMask = std::numeric_limits<Entity>::max() >> EntityIndexBits;
+
+inline Entity entityIndex(Entity entity)
+{
+    return entity & EntityIndexMask;
+}
+
+inline Entity entityVersion(Entity entity)
+{
+    return entity >> EntityIndexBits;
+}
+
+inline Entity makeEntity(Entity index, Entity version)
+{
+    return (index & EntityIndexMask) | ((version & EntityVersionMask) << EntityIndexBits);
+}
+
+/// Upper bound on distinct component types, one bit per type in an entity's Signature
+static constexpr size_t MaxComponents = 64;
+static_assert(MaxComponents <= 64, "Registry::remove walks signatures as a 64-bit mask");
+
+/// Set of component types an entity holds, indexed by ComponentId
+using Signature = std::bitset<MaxComponents>;
+
+inline size_t nextComponentId = 0;
+
+inline size_t assignComponentId()
+{
+    if (nextComponentId >= MaxComponents)
+    {
+        std::cerr << "Too many component types, raise MaxComponents" << std::endl;
+        std::abort();
+    }
+    return nextComponentId++;
+}
+
+/// Dense id of component type T, assigned once per type during static initialization
+template <typename T>
+inline const size_t ComponentId = assignComponentId();
+
+/// Sparse index value marking an entity without a component in a storage
+static constexpr Entity NullIndex = std::numeric_limits<Entity>::max();
+
+/// Number of sparse index entries per page, pages are allocated on first insert
+static constexpr size_t SparsePageSize = 4096;
+
+struct GroupBase
+{
+    virtual ~GroupBase() {}
+    virtual void onInsert(Entity entity) = 0;
+    virtual void onRemove(Entity entity) = 0;
+};
+
+/// Allocates on 64 byte boundaries, so a dense array split at multiples of 64 elements is split on cache lines
+template <typename T>
+struct CacheLineAllocator
+{
+    using value_type = T;
+    static constexpr std::align_val_t Alignment {64};
+
+    CacheLineAllocator() = default;
+
+    template <typename U>
+    CacheLineAllocator(const CacheLineAllocator<U> &)
+    {
+    }
+
+    T *allocate(size_t count)
+    {
+        return static_cast<T *>(::operator new(count * sizeof(T), Alignment));
+    }
+
+    void deallocate(T *pointer, size_t count)
+    {
+        ::operator delete(pointer, count * sizeof(T), Alignment);
+    }
+
+    template <typename U>
+    bool operator==(const CacheLineAllocator<U> &) const
+    {
+        return true;
+    }
+};
 
 struct ComponentStorageBase
 {
     virtual ~ComponentStorageBase() {}
     virtual void remove(Entity entity) = 0;
+    GroupBase *group = nullptr;
 };
 
 template <typename T>
 struct ComponentStorage : ComponentStorageBase
 {
-    std::vector<T> dense;
-    std::vector<Entity> denseIndex = std::vector<Entity>(MaxEntities);
+    std::vector<T, CacheLineAllocator<T>> dense;
+    std::vector<std::unique_ptr<Entity[]>> sparse;
     std::vector<Entity> denseEntity;
 
-    bool contains(Entity entity)
+    /// Observers keeping indices over this component in sync. Insert observers run after a component
+    /// was added, remove observers before it goes away, a replace notifies a remove followed by an insert.
+    /// Writes through references returned by get() are not observed.
+    std::vector<std::function<void(Entity, const T &)>> insertObservers;
+    std::vector<std::function<void(Entity, const T &)>> removeObservers;
+
+    /// Returns the dense index of entity or NullIndex when its page was never allocated
+    Entity index(Entity entity) const
+    {
+        auto page = entityIndex(entity) / SparsePageSize;
+        return page < sparse.size() && sparse[page] ? sparse[page][entityIndex(entity) % SparsePageSize] : NullIndex;
+    }
+
+    /// Returns the sparse slot of entity, allocating its page on demand
+    Entity &sparseSlot(Entity entity)
     {
-        auto denseId = denseIndex[entity];
+        auto page = entityIndex(entity) / SparsePageSize;
+        if (page >= sparse.size())
+        {
+            sparse.resize(page + 1);
+        }
+        if (not sparse[page])
+        {
+            sparse[page] = std::make_unique<Entity[]>(SparsePageSize);
+            std::fill_n(sparse[page].get(), SparsePageSize, NullIndex);
+        }
+        return sparse[page][entityIndex(entity) % SparsePageSize];
+    }
+
+    bool contains(Entity entity) const
+    {
+        auto denseId = index(entity);
         return denseId < denseEntity.size() && denseEntity[denseId] == entity;
     }
 
+    /// Swaps two components in the dense arrays, used by groups to pack their members at the front
+    void swapPositions(size_t first, size_t second)
+    {
+        std::swap(dense[first], dense[second]);
+        std::swap(denseEntity[first], denseEntity[second]);
+        sparseSlot(denseEntity[first]) = first;
+        sparseSlot(denseEntity[second]) = second;
+    }
+
     void remove(Entity entity) override
     {
         if (contains(entity))
         {
-            Entity lastEntity = denseEntity.back();
-            size_t lastIndex = denseEntity.size() - 1;
-            size_t entityIndex = denseIndex[entity];
-            std::swap(denseEntity[lastIndex], denseEntity[entityIndex]);
-            std::swap(dense[lastIndex], dense[entityIndex]);
-            denseIndex[lastEntity] = entityIndex;
-            denseIndex[entity] = MaxEntities;
+            for (auto &observer : removeObservers)
+            {
+                observer(entity, get(entity));
+            }
+            swapPositions(index(entity), denseEntity.size() - 1);
+            sparseSlot(entity) = NullIndex;
             denseEntity.pop_back();
             dense.pop_back();
             if constexpr(DEBUGGING && std::is_same<T, glm::vec2>::value)
@@ -58,10 +198,10 @@ struct ComponentStorage : ComponentStorageBase
                     std::cerr << en << " ";
                 }
                 std::cerr << std::endl;
-                std::cerr << "denseIndex: ";
-                for (auto in: denseIndex)
+                std::cerr << "sparse: ";
+                for (auto en: denseEntity)
                 {
-                    std::cerr << in << " ";
+                    std::cerr << index(en) << " ";
                 }
                 std::cerr << std::endl;
                 std::cerr << "dense: ";
@@ -77,10 +217,10 @@ struct ComponentStorage : ComponentStorageBase
 
     T &insert(Entity entity, const T &component)
     {
-        auto index = dense.size();
+        auto denseId = dense.size();
         dense.push_back(component);
         denseEntity.push_back(entity);
-        denseIndex[entity] = index;
+        sparseSlot(entity) = denseId;
         if constexpr(DEBUGGING && std::is_same<T, glm::vec2>::value)
         {
             std::cerr << "Inserting " << entity << " at " << component.x << " " << component.y << std::endl;
@@ -90,10 +230,10 @@ struct ComponentStorage : ComponentStorageBase
                 std::cerr << en << " ";
             }
             std::cerr << std::endl;
-            std::cerr << "denseIndex: ";
-            for (auto in: denseIndex)
+            std::cerr << "sparse: ";
+            for (auto en: denseEntity)
             {
-                std::cerr << in << " ";
+                std::cerr << index(en) << " ";
             }
             std::cerr << std::endl;
             std::cerr << "dense: ";
@@ -104,14 +244,26 @@ struct ComponentStorage : ComponentStorageBase
             std::cerr << std::endl;
 
         }
-        return dense.at(index);
+        for (auto &observer : insertObservers)
+        {
+            observer(entity, component);
+        }
+        return dense.at(denseId);
     }
 
     T &replace(Entity entity, const T &component)
     {
-        auto index = denseIndex[entity];
-        dense[index] = component;
-        return dense[index];
+        auto denseId = index(entity);
+        for (auto &observer : removeObservers)
+        {
+            observer(entity, dense[denseId]);
+        }
+        dense[denseId] = component;
+        for (auto &observer : insertObservers)
+        {
+            observer(entity, component);
+        }
+        return dense[denseId];
     }
 
     T &insert_or_replace(Entity entity, const T &component)
@@ -121,8 +273,7 @@ struct ComponentStorage : ComponentStorageBase
 
     T &get(Entity entity)
     {
-        auto index = denseIndex[entity];
-        return dense[index];
+        return dense[sparse[entityIndex(entity) / SparsePageSize][entityIndex(entity) % SparsePageSize]];
     }
 
     const std::vector<Entity> &entities() const
@@ -130,45 +281,270 @@ struct ComponentStorage : ComponentStorageBase
         return denseEntity;
     }
 
-    std::vector<T *> get(const std::vector<Entity> &entities) const
+    std::vector<T *> get(const std::vector<Entity> &entities)
     {
         std::vector<T *> result;
         for (auto entity : entities)
         {
-            result.push_back(dense[denseIndex[entity]]);
+            result.push_back(&get(entity));
         }
         return result;
     }
 };
 
+/// Returns the entity list of the storage holding the fewest components, the cheapest one to drive a join
+template <typename... Components>
+const std::vector<Entity> &smallestEntities(ComponentStorage<Components> *...storages)
+{
+    const std::vector<Entity> *entities = nullptr;
+    ((entities = not entities || storages->entities().size() < entities->size() ? &storages->entities() : entities), ...);
+    return *entities;
+}
+
+/// Lazy join over the storages of Components, yields (entity, components...) tuples of references.
+/// Walks the smallest storage back to front so the current entity may be removed while iterating.
+template <typename... Components>
+class View
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::tuple<Entity, Components &...>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator() = default;
+        Iterator(const View *view, size_t position) : m_view(view), m_position(position)
+        {
+            skipInvalid();
+        }
+
+        value_type operator*() const
+        {
+            Entity entity = (*m_view->m_entities)[m_position - 1];
+            return value_type(entity, std::get<ComponentStorage<Components> *>(m_view->m_storages)->get(entity)...);
+        }
+
+        Iterator &operator++()
+        {
+            --m_position;
+            skipInvalid();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator &other) const
+        {
+            return m_position == other.m_position;
+        }
+
+    private:
+        void skipInvalid()
+        {
+            while (m_position > 0 && not m_view->accepts(m_position - 1))
+            {
+                --m_position;
+            }
+        }
+
+        const View *m_view = nullptr;
+        size_t m_position = 0;
+    };
+
+    View(ComponentStorage<Components> *...storages) : m_storages(storages...), m_entities(&smallestEntities(storages...))
+    {
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(this, m_entities->size());
+    }
+
+    Iterator end() const
+    {
+        return Iterator(this, 0);
+    }
+
+private:
+    bool accepts(size_t position) const
+    {
+        if (position >= m_entities->size())
+        {
+            return false;
+        }
+        Entity entity = (*m_entities)[position];
+        return (std::get<ComponentStorage<Components> *>(m_storages)->contains(entity) && ...);
+    }
+
+    std::tuple<ComponentStorage<Components> *...> m_storages;
+    const std::vector<Entity> *m_entities;
+};
+
+/// Owning group, keeps the components of entities having all of Owned packed at the front
+/// of each owned storage in the same order, so iterating them is a linear walk over parallel arrays.
+/// A storage can be owned by one group only. Walks back to front like View.
+template <typename... Owned>
+class Group : public GroupBase
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::tuple<Entity, Owned &...>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator() = default;
+        Iterator(const Group *group, size_t position) : m_group(group), m_position(position)
+        {
+        }
+
+        value_type operator*() const
+        {
+            auto &storages = m_group->m_storages;
+            return value_type(std::get<0>(storages)->denseEntity[m_position - 1], std::get<ComponentStorage<Owned> *>(storages)->dense[m_position - 1]...);
+        }
+
+        Iterator &operator++()
+        {
+            m_position = std::min(m_position - 1, m_group->m_size);
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator &other) const
+        {
+            return m_position == other.m_position;
+        }
+
+    private:
+        const Group *m_group = nullptr;
+        size_t m_position = 0;
+    };
+
+    Group(ComponentStorage<Owned> *...storages) : m_storages(storages...)
+    {
+        ((storages->group = this), ...);
+        for (auto entity : smallestEntities(storages...))
+        {
+            onInsert(entity);
+        }
+    }
+
+    ~Group()
+    {
+        ((std::get<ComponentStorage<Owned> *>(m_storages)->group = nullptr), ...);
+    }
+
+    void onInsert(Entity entity) override
+    {
+        auto first = std::get<0>(m_storages);
+        if ((std::get<ComponentStorage<Owned> *>(m_storages)->contains(entity) && ...) && first->index(entity) >= m_size)
+        {
+            (std::get<ComponentStorage<Owned> *>(m_storages)->swapPositions(std::get<ComponentStorage<Owned> *>(m_storages)->index(entity), m_size), ...);
+            ++m_size;
+        }
+    }
+
+    void onRemove(Entity entity) override
+    {
+        auto first = std::get<0>(m_storages);
+        if (first->contains(entity) && first->index(entity) < m_size)
+        {
+            --m_size;
+            (std::get<ComponentStorage<Owned> *>(m_storages)->swapPositions(std::get<ComponentStorage<Owned> *>(m_storages)->index(entity), m_size), ...);
+        }
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(this, m_size);
+    }
+
+    Iterator end() const
+    {
+        return Iterator(this, 0);
+    }
+
+private:
+    std::tuple<ComponentStorage<Owned> *...> m_storages;
+    size_t m_size = 0;
+};
+
 class Registry
 {
 public:
+    /// Returns a new entity, or the zero handle when every slot below the EntityIndexBits ceiling is in use
     Entity create();
     ~Registry() {
-        for (auto comp : m_storage)
+        for (auto group : m_groups)
         {
-            delete comp.second;
+            delete group.second;
+        }
+        for (auto &storage : m_pools)
+        {
+            delete storage.load();
         }
     }
 
+    /// Storages live in a flat array indexed by ComponentId, so this is a single load after the first call.
+    /// Creation is locked, systems running concurrently may be the first to touch a component type.
     template <typename T>
     ComponentStorage<T>* getStorage()
     {
-        if (not m_storage.contains(typeid(T)))
-            m_storage.insert({typeid(T), new ComponentStorage<T>});
-        return static_cast<ComponentStorage<T>*>(m_storage[typeid(T)]);
+        auto storage = m_pools[ComponentId<T>].load(std::memory_order_acquire);
+        if (not storage) [[unlikely]]
+        {
+            std::lock_guard lock(m_poolsMutex);
+            storage = m_pools[ComponentId<T>].load(std::memory_order_relaxed);
+            if (not storage)
+            {
+                storage = new ComponentStorage<T>;
+                m_pools[ComponentId<T>].store(storage, std::memory_order_release);
+            }
+        }
+        return static_cast<ComponentStorage<T>*>(storage);
     }
 
     template <typename T>
     T &insert_or_replace(Entity entity, const T &component)
     {
-        return getStorage<T>()->insert_or_replace(entity, component);
+        auto storage = getStorage<T>();
+        return storage->contains(entity) ? storage->replace(entity, component) : insert(entity, component);
     }
     template <typename T>
     T &insert(Entity entity, const T &component)
     {
-        return getStorage<T>()->insert(entity, component);
+        auto storage = getStorage<T>();
+        storage->insert(entity, component);
+        m_signatures[entityIndex(entity)].set(ComponentId<T>);
+        if (storage->group)
+        {
+            storage->group->onInsert(entity);
+        }
+        return storage->get(entity);
     }
     template <typename T>
     T &replace(Entity entity, const T &component)
@@ -190,15 +566,76 @@ public:
     template <typename T>
     void remove(Entity entity)
     {
-        return getStorage<T>()->remove(entity);
+        auto storage = getStorage<T>();
+        if (not storage->contains(entity))
+        {
+            return;
+        }
+        if (storage->group)
+        {
+            storage->group->onRemove(entity);
+        }
+        storage->remove(entity);
+        m_signatures[entityIndex(entity)].reset(ComponentId<T>);
     }
 
+    /// Removes all components of entity and recycles its slot, stale handles are ignored.
+    /// Only the storages set in the entity's signature are visited.
     void remove(Entity entity)
     {
-        for (auto& [_, storage] : m_storage)
+        if (not valid(entity))
+        {
+            return;
+        }
+        auto index = entityIndex(entity);
+        for (auto bits = m_signatures[index].to_ullong(); bits != 0; bits &= bits - 1)
         {
+            auto storage = m_pools[std::countr_zero(bits)].load(std::memory_order_relaxed);
+            if (storage->group)
+            {
+                storage->group->onRemove(entity);
+            }
             storage->remove(entity);
         }
+        m_signatures[index].reset();
+        m_entities[index] = makeEntity(index, entityVersion(entity) + 1);
+        m_freeList.push_back(index);
+    }
+
+    void remove(std::span<const Entity> entities)
+    {
+        for (auto entity : entities)
+        {
+            remove(entity);
+        }
+    }
+
+    /// Returns whether entity was created and not removed since
+    bool valid(Entity entity) const
+    {
+        auto index = entityIndex(entity);
+        return index != 0 && index < m_entities.size() && m_entities[index] == entity;
+    }
+
+    /// Returns the owning group of Owned, creating it and packing the current members on first use
+    template <typename... Owned>
+        requires(sizeof...(Owned) >= 2)
+    Group<Owned...> &group()
+    {
+        // Lookups of existing groups do not modify the map, systems running concurrently may share a group
+        auto existing = m_groups.find(typeid(Group<Owned...>));
+        if (existing != m_groups.end())
+        {
+            return *static_cast<Group<Owned...> *>(existing->second);
+        }
+        if ((getStorage<Owned>()->group || ...))
+        {
+            std::cerr << "Component storage is already owned by another group" << std::endl;
+            std::abort();
+        }
+        auto group = new Group<Owned...>(getStorage<Owned>()...);
+        m_groups[typeid(Group<Owned...>)] = group;
+        return *group;
     }
 
     template <typename Component>
@@ -207,37 +644,61 @@ public:
         return getStorage<Component>()->entities();
     }
 
+    /// Entities owning all components, found by probing the smallest storage against the others
     template <typename Component, typename... OtherComponents>
         requires(sizeof...(OtherComponents) >= 1)
     std::vector<Entity> getEntities()
     {
-        auto otherEntities = getEntities<OtherComponents...>();
-        auto entities = getStorage<Component>()->entities();
-        std::erase_if(otherEntities, [storage = getStorage<Component>()](Entity e)
-                      { return !storage->contains(e); });
-        return otherEntities;
+        return getEntities(getStorage<Component>(), getStorage<OtherComponents>()...);
     }
 
     template <typename... Components>
-    auto each()
+    View<Components...> each()
     {
-        auto entities = getEntities<Components...>();
-        std::vector<decltype(std::make_tuple(*entities.begin(), std::ref(getStorage<Components>()->get(*entities.begin()))...))> result;
-        for (auto entity : entities)
+        return View<Components...>(getStorage<Components>()...);
+    }
+
+private:
+    template <typename... Components>
+    std::vector<Entity> getEntities(ComponentStorage<Components> *...storages)
+    {
+        auto &driver = smallestEntities(storages...);
+        std::vector<Entity> result;
+        result.reserve(driver.size());
+        for (auto entity : driver)
         {
-            result.push_back(std::make_tuple(entity, std::ref(getStorage<Components>()->get(entity))...));
+            if ((storages->contains(entity) && ...))
+            {
+                result.push_back(entity);
+            }
         }
         return result;
     }
 
-private:
-    std::unordered_map<std::type_index, ComponentStorageBase *> m_storage;
-    int nextEntity = 1;
+    std::array<std::atomic<ComponentStorageBase *>, MaxComponents> m_pools = {};
+    std::mutex m_poolsMutex;
+    std::unordered_map<std::type_index, GroupBase *> m_groups;
+    std::vector<Entity> m_entities = {0};
+    std::vector<Signature> m_signatures = {{}};
+    std::vector<Entity> m_freeList;
 };
 
 inline Entity Registry::create()
 {
-    Entity entity = nextEntity++;
+    if (not m_freeList.empty())
+    {
+        auto index = m_freeList.back();
+        m_freeList.pop_back();
+        return m_entities[index];
+    }
+    if (m_entities.size() > EntityIndexMask)
+    {
+        std::cerr << "Out of entity slots, " << EntityIndexMask << " entities are alive" << std::endl;
+        return 0;
+    }
+    Entity entity = makeEntity(m_entities.size(), 0);
+    m_entities.push_back(entity);
+    m_signatures.emplace_back();
     return entity;
 }
 
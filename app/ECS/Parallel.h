@@ -0,0 +1,77 @@
+#ifndef ECS_PARALLEL_H
+#define ECS_PARALLEL_H
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include "ECS/ECS.h"
+#include "ECS/CommandBuffer.h"
+#include "Jobs/ThreadPool.h"
+
+/// Chunk boundaries fall on multiples of this many entities. Dense arrays start on a cache line, so the components
+/// of the driving storage are split on cache line boundaries and neighbouring chunks never write the same line of it.
+/// Components of the other storages are reached through get at their own dense positions and may share lines across chunks.
+static constexpr size_t ParallelChunkAlignment = 64;
+
+/// Joins smaller than this run on the calling thread
+static constexpr size_t ParallelMinChunkSize = 256;
+
+/// Runs function(commands, entity, components&...) over the join of Components, split into chunks of the
+/// smallest storage that run on threadPool. Every chunk records into its own CommandBuffer, the buffers are
+/// appended to commands in chunk order once all chunks finished, so the recorded changes come out in the
+/// same order for any thread count. Components may be written in place, structural changes must be recorded.
+template <typename... Components, typename Function>
+void parallelEach(Registry &registry, ThreadPool &threadPool, CommandBuffer &commands, Function function)
+{
+    auto storages = std::make_tuple(registry.getStorage<Components>()...);
+    auto &entities = smallestEntities(registry.getStorage<Components>()...);
+    auto count = entities.size();
+    auto chunkSize = std::max(ParallelMinChunkSize, count / (4 * threadPool.concurrency()));
+    chunkSize = (chunkSize + ParallelChunkAlignment - 1) / ParallelChunkAlignment * ParallelChunkAlignment;
+    auto chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    auto runChunk = [&](size_t chunk, CommandBuffer &chunkCommands)
+    {
+        auto end = std::min(count, (chunk + 1) * chunkSize);
+        for (auto i = chunk * chunkSize; i < end; i++)
+        {
+            Entity entity = entities[i];
+            if ((std::get<ComponentStorage<Components> *>(storages)->contains(entity) && ...))
+            {
+                function(chunkCommands, entity, std::get<ComponentStorage<Components> *>(storages)->get(entity)...);
+            }
+        }
+    };
+
+    if (chunkCount <= 1)
+    {
+        runChunk(0, commands);
+        return;
+    }
+
+    std::vector<CommandBuffer> chunkCommands(chunkCount);
+    TaskGroup group;
+    for (size_t chunk = 1; chunk < chunkCount; chunk++)
+    {
+        threadPool.submit(group, [&, chunk] { runChunk(chunk, chunkCommands[chunk]); });
+    }
+    runChunk(0, chunkCommands[0]);
+    threadPool.wait(group);
+
+    for (auto &chunkBuffer : chunkCommands)
+    {
+        commands.append(std::move(chunkBuffer));
+    }
+}
+
+/// Runs function(entity, components&...) over the join of Components in parallel chunks, for loops that only write their own components
+template <typename... Components, typename Function>
+void parallelEach(Registry &registry, ThreadPool &threadPool, Function function)
+{
+    CommandBuffer commands;
+    parallelEach<Components...>(registry, threadPool, commands, [&function](CommandBuffer &, Entity entity, Components &...components)
+                                { function(entity, components...); });
+}
+
+#endif
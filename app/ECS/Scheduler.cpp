@@ -0,0 +1,63 @@
+#include "ECS/Scheduler.h"
+
+#include "Profiler/Profiler.h"
+
+Scheduler::Scheduler(ThreadPool& threadPool)
+    : m_threadPool(threadPool)
+{
+}
+
+void Scheduler::add(const std::string& name, Signature reads, Signature writes, std::function<void(float)> system)
+{
+    SystemNode node { name, reads, writes, std::move(system) };
+    auto index = m_systems.size();
+    for (size_t i = 0; i < index; i++)
+    {
+        auto& earlier = m_systems[i];
+        bool conflicts = (earlier.writes & (node.reads | node.writes)).any() || (earlier.reads & node.writes).any();
+        if (conflicts)
+        {
+            earlier.dependents.push_back(index);
+            node.dependencyCount++;
+        }
+    }
+    m_systems.push_back(std::move(node));
+    m_remainingDependencies = std::make_unique<std::atomic<size_t>[]>(m_systems.size());
+}
+
+void Scheduler::submit(size_t index, float deltaTime, TaskGroup& group)
+{
+    m_threadPool.submit(group, [this, index, deltaTime, &group]
+    {
+        auto& node = m_systems[index];
+        {
+            PROFILE_ZONE(node.name.c_str());
+            node.system(deltaTime);
+        }
+        for (auto dependent : node.dependents)
+        {
+            if (m_remainingDependencies[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                submit(dependent, deltaTime, group);
+            }
+        }
+    });
+}
+
+void Scheduler::run(float deltaTime)
+{
+    PROFILE_ZONE("Scheduler");
+    for (size_t i = 0; i < m_systems.size(); i++)
+    {
+        m_remainingDependencies[i].store(m_systems[i].dependencyCount, std::memory_order_relaxed);
+    }
+    TaskGroup group;
+    for (size_t i = 0; i < m_systems.size(); i++)
+    {
+        if (m_systems[i].dependencyCount == 0)
+        {
+            submit(i, deltaTime, group);
+        }
+    }
+    m_threadPool.wait(group);
+}
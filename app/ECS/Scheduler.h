@@ -0,0 +1,64 @@
+#ifndef ECS_SCHEDULER_H
+#define ECS_SCHEDULER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ECS/ECS.h"
+#include "Jobs/ThreadPool.h"
+
+/// Component and resource types a system reads, resources share the ComponentId numbering
+template <typename... Ts>
+struct Reads {};
+
+/// Component and resource types a system writes
+template <typename... Ts>
+struct Writes {};
+
+/// Runs systems on a ThreadPool, ordered by the data they declare to read and write.
+/// A system waits for every earlier added system that writes what it reads or writes,
+/// or reads what it writes. Systems without such conflicts run concurrently.
+/// Structural registry changes must go through a CommandBuffer applied after run().
+class Scheduler
+{
+public:
+    explicit Scheduler(ThreadPool& threadPool);
+
+    template <typename ReadSet, typename WriteSet>
+    void add(const std::string& name, std::function<void(float)> system)
+    {
+        add(name, signature(ReadSet{}), signature(WriteSet{}), std::move(system));
+    }
+
+    void run(float deltaTime);
+
+private:
+    struct SystemNode
+    {
+        std::string name;
+        Signature reads;
+        Signature writes;
+        std::function<void(float)> system;
+        std::vector<size_t> dependents;
+        size_t dependencyCount = 0;
+    };
+
+    template <template <typename...> typename Set, typename... Ts>
+    static Signature signature(Set<Ts...>)
+    {
+        Signature result;
+        (result.set(ComponentId<Ts>), ...);
+        return result;
+    }
+
+    void add(const std::string& name, Signature reads, Signature writes, std::function<void(float)> system);
+    void submit(size_t index, float deltaTime, TaskGroup& group);
+
+    ThreadPool& m_threadPool;
+    std::vector<SystemNode> m_systems;
+    std::unique_ptr<std::atomic<size_t>[]> m_remainingDependencies;
+};
+
+#endif
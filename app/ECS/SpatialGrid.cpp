@@ -0,0 +1,86 @@
+#include "ECS/SpatialGrid.h"
+
+#include <algorithm>
+
+SpatialGrid::SpatialGrid(Registry &registry) : m_registry(registry)
+{
+    auto storage = registry.getStorage<glm::ivec2>();
+    storage->insertObservers.push_back([this](Entity entity, const glm::ivec2 &position) { insert(entity, position); });
+    storage->removeObservers.push_back([this](Entity entity, const glm::ivec2 &position) { remove(entity, position); });
+    for (auto [entity, position] : registry.each<glm::ivec2>())
+    {
+        insert(entity, position);
+    }
+}
+
+bool SpatialGrid::covers(const glm::ivec2 &position) const
+{
+    return position.x >= m_origin.x && position.y >= m_origin.y && position.x < m_origin.x + m_size.x && position.y < m_origin.y + m_size.y;
+}
+
+size_t SpatialGrid::cellIndex(const glm::ivec2 &position) const
+{
+    return static_cast<size_t>(position.y - m_origin.y) * m_size.x + (position.x - m_origin.x);
+}
+
+Entity SpatialGrid::head(const glm::ivec2 &position) const
+{
+    return covers(position) ? m_cells[cellIndex(position)] : 0;
+}
+
+void SpatialGrid::grow(const glm::ivec2 &position)
+{
+    // Grow by at least half the current extent on the side that is short, so a map loaded tile by tile
+    // only reallocates a logarithmic number of times
+    glm::ivec2 minimum = m_size.x == 0 ? position : glm::ivec2 { std::min(m_origin.x, position.x), std::min(m_origin.y, position.y) };
+    glm::ivec2 maximum = m_size.x == 0 ? position + glm::ivec2 {1, 1} : glm::ivec2 { std::max(m_origin.x + m_size.x, position.x + 1), std::max(m_origin.y + m_size.y, position.y + 1) };
+    glm::ivec2 padding { std::max(16, m_size.x / 2), std::max(16, m_size.y / 2) };
+    if (minimum.x < m_origin.x || m_size.x == 0) minimum.x -= padding.x;
+    if (minimum.y < m_origin.y || m_size.y == 0) minimum.y -= padding.y;
+    if (maximum.x > m_origin.x + m_size.x || m_size.x == 0) maximum.x += padding.x;
+    if (maximum.y > m_origin.y + m_size.y || m_size.y == 0) maximum.y += padding.y;
+
+    std::vector<Entity> cells(static_cast<size_t>(maximum.x - minimum.x) * (maximum.y - minimum.y), 0);
+    for (int y = 0; y < m_size.y; y++)
+    {
+        auto row = m_cells.begin() + static_cast<size_t>(y) * m_size.x;
+        auto target = cells.begin() + static_cast<size_t>(m_origin.y + y - minimum.y) * (maximum.x - minimum.x) + (m_origin.x - minimum.x);
+        std::copy(row, row + m_size.x, target);
+    }
+    m_cells = std::move(cells);
+    m_origin = minimum;
+    m_size = maximum - minimum;
+}
+
+void SpatialGrid::insert(Entity entity, const glm::ivec2 &position)
+{
+    if (!covers(position))
+    {
+        grow(position);
+    }
+    auto index = entityIndex(entity);
+    if (index >= m_next.size())
+    {
+        m_next.resize(std::max<size_t>(index + 1, 2 * m_next.size()), 0);
+    }
+    auto &cell = m_cells[cellIndex(position)];
+    m_next[index] = cell;
+    cell = entity;
+}
+
+void SpatialGrid::remove(Entity entity, const glm::ivec2 &position)
+{
+    if (!covers(position))
+    {
+        return;
+    }
+    auto *link = &m_cells[cellIndex(position)];
+    while (*link != 0 && *link != entity)
+    {
+        link = &m_next[entityIndex(*link)];
+    }
+    if (*link == entity)
+    {
+        *link = m_next[entityIndex(entity)];
+    }
+}
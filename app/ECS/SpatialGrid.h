@@ -0,0 +1,77 @@
+#ifndef ECS_SPATIALGRID_H
+#define ECS_SPATIALGRID_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ECS/ECS.h"
+
+/// Uniform grid from tile positions to the entities whose glm::ivec2 component holds that position.
+/// Observes the glm::ivec2 storage, so inserts, replaces and removes through the registry keep it in sync.
+/// Entities sharing a cell are chained through a per entity link, the grid grows to cover new positions.
+class SpatialGrid
+{
+public:
+    explicit SpatialGrid(Registry &registry);
+
+    SpatialGrid(const SpatialGrid &) = delete;
+    SpatialGrid &operator=(const SpatialGrid &) = delete;
+
+    /// Calls function(entity) for every entity at position
+    template <typename Function>
+    void forEachAt(const glm::ivec2 &position, Function function) const
+    {
+        for (auto entity = head(position); entity != 0; entity = m_next[entityIndex(entity)])
+        {
+            function(entity);
+        }
+    }
+
+    /// Calls function(entity) for every entity with a position in the rectangle from minimum to maximum, both inclusive
+    template <typename Function>
+    void forEachIn(const glm::ivec2 &minimum, const glm::ivec2 &maximum, Function function) const
+    {
+        auto first = glm::max(minimum, m_origin);
+        auto last = glm::min(maximum, m_origin + m_size - glm::ivec2 {1, 1});
+        for (int y = first.y; y <= last.y; y++)
+        {
+            for (int x = first.x; x <= last.x; x++)
+            {
+                for (auto entity = m_cells[cellIndex({x, y})]; entity != 0; entity = m_next[entityIndex(entity)])
+                {
+                    function(entity);
+                }
+            }
+        }
+    }
+
+    /// Returns the first entity at position that has component T, 0 if there is none
+    template <typename T>
+    Entity find(const glm::ivec2 &position) const
+    {
+        for (auto entity = head(position); entity != 0; entity = m_next[entityIndex(entity)])
+        {
+            if (m_registry.has<T>(entity))
+            {
+                return entity;
+            }
+        }
+        return 0;
+    }
+
+private:
+    void insert(Entity entity, const glm::ivec2 &position);
+    void remove(Entity entity, const glm::ivec2 &position);
+    void grow(const glm::ivec2 &position);
+    bool covers(const glm::ivec2 &position) const;
+    size_t cellIndex(const glm::ivec2 &position) const;
+    Entity head(const glm::ivec2 &position) const;
+
+    Registry &m_registry;
+    glm::ivec2 m_origin {0, 0};
+    glm::ivec2 m_size {0, 0};
+    std::vector<Entity> m_cells;
+    std::vector<Entity> m_next;
+};
+
+#endif
@@ -4,19 +4,26 @@
 
 std::unordered_map<int, KeyState> keyStates;
 
+// Queries never insert, so systems running concurrently can read key states
+KeyState keyState(int key)
+{
+    auto state = keyStates.find(key);
+    return state != keyStates.end() ? state->second : KeyState::RELEASED;
+}
+
 bool isHolded(int key)
 {
-    return keyStates[key] != KeyState::RELEASED;
+    return keyState(key) != KeyState::RELEASED;
 }
 
 bool isPressed(int key)
 {
-    return keyStates[key] == KeyState::PRESSED;
+    return keyState(key) == KeyState::PRESSED;
 }
 
 bool isPressedOrRepeated(int key)
 {
-    return keyStates[key] == KeyState::PRESSED || keyStates[key] == KeyState::REPEATED;
+    return keyState(key) == KeyState::PRESSED || keyState(key) == KeyState::REPEATED;
 }
 
 void markKeyStatesHold()
@@ -1,14 +1,18 @@
 
 // TODO: Move ECS and Renderer to library, keep Systems in app
 
+#include <algorithm>
 #include <random>
 #include <sstream>
 #include <fstream>
+#include <atomic>
 
 #include "ECS/Systems/Systems.h"
 
 #include "ECS/ECS.h"
+#include "ECS/Parallel.h"
 #include "Catalog.h"
+#include "LevelFile.h"
 #include "Renderer/Renderer.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -20,6 +24,12 @@ using Pos = glm::vec2;
 
 bool editing = false;
 
+/// Decorations are drawn on layer 1, the oven stands between the characters on layer 2
+Layer decoLayer(DecoType type)
+{
+    return {type == DecoType::OVEN ? 2 : 1};
+}
+
 void MovementSystem::run(Registry &registry, float deltaTime)
 {
     if (editing || !gameState.allowMovement)
@@ -47,10 +57,9 @@ void MovementSystem::run(Registry &registry, float deltaTime)
         auto worldDisplacement = speed * deltaTime * glm::normalize(displacement);
         auto newPos = posTink + worldDisplacement;
         glm::ivec2 tilePos { newPos.x, newPos.y };
-        for (auto [_, pos, __] : registry.each<glm::ivec2, Blocked>())
+        if (tilemap.blocked(tilePos))
         {
-            if (pos == tilePos)
-                return;
+            return;
         }
         if (camera)
         {
@@ -60,42 +69,33 @@ void MovementSystem::run(Registry &registry, float deltaTime)
     }
 }
 
-void loadLevel(Registry& registry)
+/// Reads the stream format levels were saved in before LevelFile, kept to convert old levels
+static void loadLegacyLevel(Registry& registry, Tilemap& tilemap, const std::filesystem::path& path)
 {
-    std::cerr << "Loading level" << std::endl;
-    std::ifstream wf("assets/levels/level.dat", std::ios::in | std::ios::binary);
+    std::ifstream wf(path, std::ios::in | std::ios::binary);
     uint32_t count = 0;
     wf.read(reinterpret_cast<char*>(&count), sizeof(count));
     if (count == 0)
     {
         return;
     }
-    for (auto [tileEntity, tileType]: registry.each<TileType>())
-    {
-        registry.remove(tileEntity);
-    }
+    tilemap.clear();
     for (uint32_t i = 0; i < count; i++)
     {
         glm::ivec2 pos;
-        TileType type;
+        int type;
         Layer layer;
         wf.read(reinterpret_cast<char*>(&pos), sizeof(pos));
         wf.read(reinterpret_cast<char*>(&type), sizeof(type));
         wf.read(reinterpret_cast<char*>(&layer), sizeof(layer));
-        auto tile = registry.create();
-        registry.insert<glm::ivec2>(tile, pos);
-        registry.insert<TileType>(tile, type);
-        registry.insert<Layer>(tile, layer);
+        tilemap.setType(pos, static_cast<TileType>(type));
     }
     wf.read(reinterpret_cast<char*>(&count), sizeof(count));
     if (count == 0)
     {
         return;
     }
-    for (auto [tileEntity, tileType]: registry.each<DecoType>())
-    {
-        registry.remove(tileEntity);
-    }
+    registry.remove(registry.getEntities<DecoType>());
     for (uint32_t i = 0; i < count; i++)
     {
         glm::ivec2 pos;
@@ -114,77 +114,151 @@ void loadLevel(Registry& registry)
     {
         return;
     }
-    for (auto [tileEntity, _]: registry.each<Blocked>())
-    {
-        registry.remove(tileEntity);
-    }
     for (uint32_t i = 0; i < count; i++)
     {
         glm::ivec2 pos;
         wf.read(reinterpret_cast<char*>(&pos), sizeof(pos));
-        for (auto [tile, tilePos, __]: registry.each<glm::ivec2, TileType>())
+        if (tilemap.type(pos) != TileType::UNSET)
         {
-            if (pos == tilePos)
-            {
-                registry.insert<glm::ivec2>(tile, pos);
-                registry.insert<Blocked>(tile, {});
-            }
+            tilemap.setBlocked(pos, true);
         }
     }
+}
 
+void loadLevel(Registry& registry, Tilemap& tilemap, const std::filesystem::path& path)
+{
+    std::cerr << "Loading level" << std::endl;
+    LevelFile::Level level;
+    if (!level.open(path))
+    {
+        return;
+    }
+    auto& chunks = level.tileChunks();
+    tilemap.clear();
+    if (!chunks.origins.empty())
+    {
+        auto minimum = chunks.origins.front();
+        auto maximum = chunks.origins.front();
+        for (auto origin : chunks.origins)
+        {
+            minimum = glm::min(minimum, origin);
+            maximum = glm::max(maximum, origin);
+        }
+        tilemap.reserve(minimum, maximum + glm::ivec2 {TileChunkSize - 1, TileChunkSize - 1});
+        for (size_t i = 0; i < chunks.origins.size(); i++)
+        {
+            tilemap.setChunk(chunks.origins[i], chunks.chunkTypes(i), chunks.chunkBlocked(i));
+        }
+    }
+
+    auto& decorations = level.decorations();
+    registry.remove(registry.getEntities<DecoType>());
+    for (size_t i = 0; i < decorations.positions.size(); i++)
+    {
+        auto tile = registry.create();
+        registry.insert<glm::ivec2>(tile, decorations.positions[i]);
+        registry.insert<DecoType>(tile, static_cast<DecoType>(decorations.types[i]));
+        registry.insert<Layer>(tile, Layer {decorations.layers[i]});
+    }
     std::cerr << "Level loaded" << std::endl;
 }
 
-void TileEditingSystem::selectTile(const glm::ivec2& nextSelectedPosition, Registry &registry)
+void saveLevel(Registry& registry, Tilemap& tilemap, const std::filesystem::path& path)
 {
-    int nextSelectedTile = 0;
-    TileType nextSelectedType = TileType::UNSET;
-    for (auto [tileEntity, pos, type]: registry.each<glm::ivec2, TileType>())
+    std::cerr << "Saving level" << std::endl;
+    LevelFile::LevelData data;
+    tilemap.forEachChunk([&](const glm::ivec2& chunkOrigin, const TileChunk& chunk)
     {
-        if (pos.x == nextSelectedPosition.x && pos.y == nextSelectedPosition.y)
+        bool empty = chunk.blocked.none() && std::all_of(chunk.types.begin(), chunk.types.end(), [](TileType type)
         {
-            nextSelectedTile = tileEntity;
-            nextSelectedType = type;
+            return type == TileType::UNSET;
+        });
+        if (empty)
+        {
+            return;
+        }
+        data.chunkOrigins.push_back(chunkOrigin);
+        data.chunkTypes.insert(data.chunkTypes.end(), chunk.types.begin(), chunk.types.end());
+        for (size_t word = 0; word < LevelFile::BlockedWords; word++)
+        {
+            uint64_t bits = 0;
+            for (size_t bit = 0; bit < 64; bit++)
+            {
+                bits |= uint64_t {chunk.blocked[word * 64 + bit]} << bit;
+            }
+            data.chunkBlocked.push_back(bits);
         }
+    });
+    for (auto [tileEntity, pos, decoType]: registry.each<glm::ivec2, DecoType>())
+    {
+        data.decorationPositions.push_back(pos);
+        data.decorationTypes.push_back(static_cast<uint32_t>(decoType));
+        data.decorationLayers.push_back(decoLayer(decoType).layer);
+    }
+    if (LevelFile::write(path, data))
+    {
+        std::cerr << "Level saved" << std::endl;
     }
-    if (nextSelectedTile != 0)
+}
+
+bool convertLegacyLevel(const std::filesystem::path& from, const std::filesystem::path& to)
+{
+    if (!std::filesystem::exists(from))
+    {
+        std::cerr << "No level to convert at " << from << std::endl;
+        return false;
+    }
+    Registry registry;
+    Tilemap tilemap;
+    loadLegacyLevel(registry, tilemap, from);
+    saveLevel(registry, tilemap, to);
+    return true;
+}
+
+void TileEditingSystem::selectTile(const glm::ivec2& nextSelectedPosition)
+{
+    auto nextSelectedType = tilemap.type(nextSelectedPosition);
+    if (nextSelectedType != TileType::UNSET)
     {
-        selectedTile = nextSelectedTile;
         selectedPosition = nextSelectedPosition;
         selectedTileType = nextSelectedType;
     }
 }
 
-TileType TileEditingSystem::typeOfNeighbor(const glm::ivec2& neighbour, Registry& registry)
+TileType TileEditingSystem::typeOfNeighbor(const glm::ivec2& neighbour)
+{
+    return tilemap.type(selectedPosition + neighbour);
+}
+
+void TileEditingSystem::placeDeco(Registry& registry, DecoType type)
 {
-    auto neighbourPos = selectedPosition + neighbour;
-    for (auto [_, pos, tileType]: registry.each<glm::ivec2, TileType>())
+    auto deco = grid.find<DecoType>(selectedPosition);
+    if (deco == 0)
     {
-        if (pos == neighbourPos)
-        {
-            return tileType;
-        }
+        deco = registry.create();
+        registry.insert<glm::ivec2>(deco, selectedPosition);
     }
-    return TileType::UNSET;
+    registry.insert_or_replace<DecoType>(deco, type);
+    registry.insert_or_replace<Layer>(deco, decoLayer(type));
 }
 
 void TileEditingSystem::run(Registry &registry, float deltaTime)
 {
     if (isPressedOrRepeated(GLFW_KEY_RIGHT) && editing)
     {
-        selectTile({selectedPosition.x + 1, selectedPosition.y}, registry);
+        selectTile({selectedPosition.x + 1, selectedPosition.y});
     }
     else if (isPressedOrRepeated(GLFW_KEY_LEFT) && editing)
     {
-        selectTile({selectedPosition.x - 1, selectedPosition.y}, registry);
+        selectTile({selectedPosition.x - 1, selectedPosition.y});
     }
     else if (isPressedOrRepeated(GLFW_KEY_UP) && editing)
     {
-        selectTile({selectedPosition.x, selectedPosition.y - 1}, registry);
+        selectTile({selectedPosition.x, selectedPosition.y - 1});
     }
     else if (isPressedOrRepeated(GLFW_KEY_DOWN) && editing)
     {
-        selectTile({selectedPosition.x, selectedPosition.y + 1}, registry);
+        selectTile({selectedPosition.x, selectedPosition.y + 1});
     }
     else if (isPressed(GLFW_KEY_E))
     {
@@ -192,252 +266,227 @@ void TileEditingSystem::run(Registry &registry, float deltaTime)
     }
     else if (isPressed(GLFW_KEY_S) && editing)
     {
-        std::cerr << "Saving level" << std::endl;
-        std::ofstream wf("assets/levels/level.dat", std::ios::out | std::ios::binary);
-        auto tiles = registry.each<glm::ivec2, TileType>();
-        uint32_t count = tiles.size();
-        wf.write(reinterpret_cast<const char*>(&count), sizeof(count));
-        for (auto [tileEntity, pos, tileType]: tiles)
-        {
-            wf.write(reinterpret_cast<char*>(&pos), sizeof(pos));
-            wf.write(reinterpret_cast<char*>(&tileType), sizeof(tileType));
-            int layer = 0;
-            wf.write(reinterpret_cast<char*>(&layer), sizeof(layer));
-        }
-        auto decoTiles = registry.each<glm::ivec2, DecoType>();
-        count = decoTiles.size();
-        wf.write(reinterpret_cast<const char*>(&count), sizeof(count));
-        for (auto [tileEntity, pos, decoType]: decoTiles)
-        {
-            wf.write(reinterpret_cast<char*>(&pos), sizeof(pos));
-            wf.write(reinterpret_cast<char*>(&decoType), sizeof(decoType));
-            int layer = decoType == DecoType::OVEN ? 2 : 1;
-            wf.write(reinterpret_cast<char*>(&layer), sizeof(layer));
-        }
-        auto blockedTiles = registry.each<glm::ivec2, Blocked>();
-        count = blockedTiles.size();
-        wf.write(reinterpret_cast<const char*>(&count), sizeof(count));
-        for (auto [tileEntity, pos, _]: blockedTiles)
-        {
-            wf.write(reinterpret_cast<char*>(&pos), sizeof(pos));
-        }
-        wf.close();
-        std::cerr << "Level saved" << std::endl;
+        saveLevel(registry, tilemap);
     }
     else if (isPressed(GLFW_KEY_L) && editing)
     {
-        loadLevel(registry);
+        loadLevel(registry, tilemap);
+        selectTile(selectedPosition);
     }
     else if (isPressed(GLFW_KEY_F2))
     {
-        loadLevel(registry);
+        loadLevel(registry, tilemap);
+        selectTile(selectedPosition);
         gameState = GameState{};
         registry.replace<Pos>(tink, {25, 20});
     }
     else if (isPressed(GLFW_KEY_F1) && editing)
     {
-        for (auto [tileEntity, _]: registry.each<TileType>())
-        {
-            registry.replace<TileType>(tileEntity, TileType::GRASS);
-        }
+        tilemap.fill(TileType::GRASS);
     }
     else if (isPressed(GLFW_KEY_G) && editing)
     {
-        registry.replace<TileType>(selectedTile, TileType::GRASS);
+        tilemap.setType(selectedPosition, TileType::GRASS);
     }
     else if (isPressed(GLFW_KEY_W) && editing)
     {
-        registry.replace<TileType>(selectedTile, TileType::WATER);
+        tilemap.setType(selectedPosition, TileType::WATER);
     }
     else if (isPressed(GLFW_KEY_P) && editing)
     {
-        registry.replace<TileType>(selectedTile, TileType::PATH);;
+        tilemap.setType(selectedPosition, TileType::PATH);
     }
     else if (isPressed(GLFW_KEY_C) && editing)
     {
-        registry.replace<TileType>(selectedTile, TileType::CLAY);
+        tilemap.setType(selectedPosition, TileType::CLAY);
     }
     else if (isPressed(GLFW_KEY_B) && editing)
     {
         bool shifted = isPressed(GLFW_KEY_LEFT_SHIFT) || isPressed(GLFW_KEY_RIGHT_SHIFT);
-        if (shifted)
-            registry.remove<Blocked>(selectedTile);
-        else
-            registry.insert_or_replace<Blocked>(selectedTile, {});
+        tilemap.setBlocked(selectedPosition, !shifted);
     }
     else if (isPressed(GLFW_KEY_1) && editing)
     {
-        registry.insert_or_replace<DecoType>(selectedTile, DecoType::WOOD);
+        placeDeco(registry, DecoType::WOOD);
     }
     else if (isPressed(GLFW_KEY_2) && editing)
     {
-        registry.insert_or_replace<DecoType>(selectedTile, DecoType::GLAZE);
+        placeDeco(registry, DecoType::GLAZE);
     }
     else if (isPressed(GLFW_KEY_3) && editing)
     {
-        registry.insert_or_replace<DecoType>(selectedTile, DecoType::FLOWER);
+        placeDeco(registry, DecoType::FLOWER);
     }
     else if (isPressed(GLFW_KEY_4) && editing)
     {
-        registry.insert_or_replace<DecoType>(selectedTile, DecoType::OVEN);
+        placeDeco(registry, DecoType::OVEN);
     }
     else if (isPressed(GLFW_KEY_5) && editing)
     {
-        registry.insert_or_replace<DecoType>(selectedTile, DecoType::BRIDGE_HOR);
+        placeDeco(registry, DecoType::BRIDGE_HOR);
     }
     else if (isPressed(GLFW_KEY_6) && editing)
     {
-        registry.insert_or_replace<DecoType>(selectedTile, DecoType::BRIDGE_VER);
+        placeDeco(registry, DecoType::BRIDGE_VER);
     }
     else if (isPressed(GLFW_KEY_N) && editing)
     {
-        auto neighbour = typeOfNeighbor({-1, 1}, registry);
+        auto neighbour = typeOfNeighbor({-1, 1});
         bool shifted = isPressed(GLFW_KEY_LEFT_SHIFT) || isPressed(GLFW_KEY_RIGHT_SHIFT);
         if (selectedTileType == TileType::GRASS && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, shifted ? TileType::WATER_GRASS_NE : TileType::GRASS_WATER_SW);
+            tilemap.setType(selectedPosition, shifted ? TileType::WATER_GRASS_NE : TileType::GRASS_WATER_SW);
         }
         if (selectedTileType == TileType::PATH && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, shifted ? TileType::WATER_PATH_NE : TileType::PATH_WATER_SW);
+            tilemap.setType(selectedPosition, shifted ? TileType::WATER_PATH_NE : TileType::PATH_WATER_SW);
         }
         if (selectedTileType == TileType::GRASS && neighbour == TileType::PATH)
         {
-            registry.replace<TileType>(selectedTile, shifted ? TileType::PATH_GRASS_NE : TileType::GRASS_PATH_SW);
+            tilemap.setType(selectedPosition, shifted ? TileType::PATH_GRASS_NE : TileType::GRASS_PATH_SW);
         }
     }
     else if (isPressed(GLFW_KEY_H) && editing)
     {
-        auto neighbour = typeOfNeighbor({-1, 0}, registry);
+        auto neighbour = typeOfNeighbor({-1, 0});
         if (selectedTileType == TileType::GRASS && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::GRASS_WATER_W);
+            tilemap.setType(selectedPosition, TileType::GRASS_WATER_W);
         }
         if (selectedTileType == TileType::PATH && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::PATH_WATER_W);
+            tilemap.setType(selectedPosition, TileType::PATH_WATER_W);
         }
         if (selectedTileType == TileType::GRASS && neighbour == TileType::PATH)
         {
-            registry.replace<TileType>(selectedTile, TileType::GRASS_PATH_W);
+            tilemap.setType(selectedPosition, TileType::GRASS_PATH_W);
         }
     }
     else if (isPressed(GLFW_KEY_Y) && editing)
     {
-        auto neighbour = typeOfNeighbor({-1, -1}, registry);
+        auto neighbour = typeOfNeighbor({-1, -1});
         bool shifted = isPressed(GLFW_KEY_LEFT_SHIFT) || isPressed(GLFW_KEY_RIGHT_SHIFT);
         if (selectedTileType == TileType::GRASS && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, shifted ? TileType::WATER_GRASS_SE : TileType::GRASS_WATER_NW);
+            tilemap.setType(selectedPosition, shifted ? TileType::WATER_GRASS_SE : TileType::GRASS_WATER_NW);
         }
         if (selectedTileType == TileType::PATH && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::PATH_WATER_NW);
+            tilemap.setType(selectedPosition, TileType::PATH_WATER_NW);
         }
     }
     else if (isPressed(GLFW_KEY_U) && editing)
     {
-        auto neighbour = typeOfNeighbor({0, -1}, registry);
+        auto neighbour = typeOfNeighbor({0, -1});
         if (selectedTileType == TileType::GRASS && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::GRASS_WATER_N);
+            tilemap.setType(selectedPosition, TileType::GRASS_WATER_N);
         }
         if (selectedTileType == TileType::PATH && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::PATH_WATER_N);
+            tilemap.setType(selectedPosition, TileType::PATH_WATER_N);
         }
     }
     else if (isPressed(GLFW_KEY_I) && editing)
     {
-        auto neighbour = typeOfNeighbor({1, -1}, registry);
+        auto neighbour = typeOfNeighbor({1, -1});
         bool shifted = isPressed(GLFW_KEY_LEFT_SHIFT) || isPressed(GLFW_KEY_RIGHT_SHIFT);
         if (selectedTileType == TileType::GRASS && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, shifted ? TileType::WATER_GRASS_SW : TileType::GRASS_WATER_NE);
+            tilemap.setType(selectedPosition, shifted ? TileType::WATER_GRASS_SW : TileType::GRASS_WATER_NE);
         }
         if (selectedTileType == TileType::PATH && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::PATH_WATER_NE);
+            tilemap.setType(selectedPosition, TileType::PATH_WATER_NE);
         }
     }
     else if (isPressed(GLFW_KEY_K) && editing)
     {
-        auto neighbour = typeOfNeighbor({1, 0}, registry);
+        auto neighbour = typeOfNeighbor({1, 0});
         if (selectedTileType == TileType::GRASS && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::GRASS_WATER_E);
+            tilemap.setType(selectedPosition, TileType::GRASS_WATER_E);
         }
         if (selectedTileType == TileType::PATH && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::PATH_WATER_E);
+            tilemap.setType(selectedPosition, TileType::PATH_WATER_E);
         }
     }
     else if (isPressed(GLFW_KEY_COMMA) && editing)
     {
-        auto neighbour = typeOfNeighbor({1, 1}, registry);
+        auto neighbour = typeOfNeighbor({1, 1});
         bool shifted = isPressed(GLFW_KEY_LEFT_SHIFT) || isPressed(GLFW_KEY_RIGHT_SHIFT);
         if (selectedTileType == TileType::GRASS && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::GRASS_WATER_SE);
+            tilemap.setType(selectedPosition, TileType::GRASS_WATER_SE);
         }
         if (selectedTileType == TileType::PATH && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, shifted ? TileType::WATER_PATH_NW : TileType::PATH_WATER_SE);
+            tilemap.setType(selectedPosition, shifted ? TileType::WATER_PATH_NW : TileType::PATH_WATER_SE);
         }
     }
     else if (isPressed(GLFW_KEY_M) && editing)
     {
-        auto neighbour = typeOfNeighbor({0, 1}, registry);
+        auto neighbour = typeOfNeighbor({0, 1});
         if (selectedTileType == TileType::GRASS && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::GRASS_WATER_S);
+            tilemap.setType(selectedPosition, TileType::GRASS_WATER_S);
         }
         if (selectedTileType == TileType::PATH && neighbour == TileType::WATER)
         {
-            registry.replace<TileType>(selectedTile, TileType::PATH_WATER_S);
+            tilemap.setType(selectedPosition, TileType::PATH_WATER_S);
         }
         if (selectedTileType == TileType::GRASS && neighbour == TileType::PATH)
         {
-            registry.replace<TileType>(selectedTile, TileType::GRASS_PATH_S);
+            tilemap.setType(selectedPosition, TileType::GRASS_PATH_S);
         }
     }
 
     // Render grid
-    Render::Material mat;
-    mat.name = "Grid";
-    mat.shader = unlitColorShader;
-    mat.renderData = lineRenderData;
+    if (gridMaterials[0] == Render::NoMaterial)
+    {
+        const std::array<glm::vec4, 3> gridColors { glm::vec4{0.f, 0.f, 0.f, 1.f}, glm::vec4{1.f, 0.f, 0.f, 1.f}, glm::vec4{1.f, 1.f, 0.f, 1.f} };
+        for (size_t i = 0; i < gridColors.size(); i++)
+        {
+            Render::Material mat;
+            mat.name = "Grid " + std::to_string(i);
+            mat.shader = unlitColorShader;
+            mat.renderData = lineRenderData;
+            mat.uniform4fs["color"] = gridColors[i];
+            gridMaterials[i] = Render::registerMaterial(mat);
+        }
+    }
 
     Render::setCamera(camera);
     Render::setLayer(1);
 
-    for (auto [tileEntity, pos, type]: registry.each<glm::ivec2, TileType>())
+    auto visible = Render::visibleBounds(*camera);
+    tilemap.eachIn(glm::floor(visible.min), glm::floor(visible.max), [&](glm::ivec2 pos, TileType type)
     {
-        Render::setSubLayer(0);
-        mat.uniform4fs["color"] = glm::vec4{0.f, 0.f, 0.f, 1.f};
-        if (registry.has<Blocked>(tileEntity))
+        // Plain, blocked and selected tiles each have their own sub layer and color
+        int gridState = 0;
+        if (tilemap.blocked(pos))
         {
-            Render::setSubLayer(1);
-            mat.uniform4fs["color"] = glm::vec4{1.f, 0.f, 0.f, 1.f};
+            gridState = 1;
         }
-        if (selectedTile == tileEntity)
+        if (selectedPosition == pos)
         {
-            Render::setSubLayer(2);
-            mat.uniform4fs["color"] = glm::vec4{1.f, 1.f, 0.f, 1.f};
+            gridState = 2;
         }
+        Render::setSubLayer(gridState);
 
         if (editing)
         {
-            if (selectedTile == 0)
+            if (tilemap.type(selectedPosition) == TileType::UNSET)
             {
-                selectedTile = tileEntity;
                 selectedPosition = pos;
+                selectedTileType = type;
             }
-            Render::setMaterial(mat);
+            Render::setMaterial(gridMaterials[gridState]);
             std::vector<glm::vec2> positions = {glm::vec2{pos}, glm::vec2{pos} + glm::vec2{1.0, 0.0}, glm::vec2{pos} + glm::vec2{1.0, 1.0}, glm::vec2{pos} + glm::vec2{0.0, 1.0}};
             Render::queue({positions[0], positions[1], positions[1], positions[2], positions[2], positions[3], positions[3], positions[0]});
         }
-    }
+    });
     Render::flush();
 }
 
@@ -500,93 +549,194 @@ std::vector<glm::vec2> TileSystem::toPosCoord(const glm::vec2& pos)
     };
 }
 
-std::vector<glm::vec2> TileSystem::toPosCoord(const glm::vec2& pos, const glm::vec2& size, const glm::vec2& translation)
+glm::vec4 TileSystem::toTextureRect(const glm::ivec2& tilePos, const glm::ivec2 tileCount, const glm::ivec2& span)
 {
     return {
-        glm::vec2{pos.x + translation.x, pos.y + translation.y},
-        glm::vec2{pos.x + translation.x + size.x, pos.y + translation.y},
-        glm::vec2{pos.x + translation.x + size.x, pos.y + translation.y + size.y},
-        glm::vec2{pos.x + translation.x + size.x, pos.y + translation.y + size.y},
-        glm::vec2{pos.x + translation.x, pos.y + translation.y + size.y},
-        glm::vec2{pos.x + translation.x, pos.y + translation.y},
+        (float) tilePos.x / tileCount.x,
+        (float) tilePos.y / tileCount.y,
+        ((float) tilePos.x + span.x) / tileCount.x,
+        ((float) tilePos.y + span.y) / tileCount.y
     };
 }
 
-void TileSystem::run(Registry &registry, float deltaTime)
+Render::MaterialHandle TileSystem::spriteMaterial(const std::string& texture)
 {
-    std::unordered_map<unsigned int, std::vector<glm::vec3>> posCoords;
-    std::unordered_map<unsigned int, std::vector<glm::vec2>> texCoords;
-    // Render tiles
-
     Render::Material mat;
-    mat.name = "Base";
-    mat.shader = unlitTextureShader;
+    mat.name = "Sprite " + texture;
+    mat.shader = spriteShader;
     mat.renderData = tileRenderData;
+    mat.texture = getTexture(textureCatalog, texture);
+    return Render::registerMaterial(mat);
+}
+
+std::vector<std::string> terrainTextureNames()
+{
+    std::vector<std::string> names;
+    for (auto& [type, atlasInfo] : tileAtlasInfoMap)
+    {
+        if (std::find(names.begin(), names.end(), atlasInfo.texture) == names.end())
+        {
+            names.push_back(atlasInfo.texture);
+        }
+    }
+    return names;
+}
+
+void TileSystem::buildChunkMesh(const glm::ivec2& chunkOrigin, const TileChunk& chunk, TileChunkMesh& mesh)
+{
+    // Every tile texture is a layer of a terrain texture array, so the chunk takes one mesh per array
+    auto arrayCount = terrainTextures->textures.size();
+    std::vector<std::vector<glm::vec2>> positions(arrayCount);
+    std::vector<std::vector<glm::vec3>> texCoords(arrayCount);
+    for (int cell = 0; cell < TileChunkArea; cell++)
+    {
+        // Types without atlas entry, like the unused minerals, have nothing to draw
+        auto atlasEntry = tileAtlasInfoMap.find(chunk.types[cell]);
+        if (atlasEntry == tileAtlasInfoMap.end())
+        {
+            continue;
+        }
+        auto& atlasInfo = atlasEntry->second;
+        auto& layer = terrainTextures->layers.at(atlasInfo.texture);
+        auto tilePositions = toPosCoord(chunkOrigin + glm::ivec2{cell % TileChunkSize, cell / TileChunkSize});
+        auto tileTexCoords = toTextureCoord(atlasInfo.pos, atlasInfo.atlasSize);
+        positions[layer.array].insert(positions[layer.array].end(), tilePositions.begin(), tilePositions.end());
+        for (auto& texCoord : tileTexCoords)
+        {
+            texCoords[layer.array].push_back(glm::vec3{texCoord, static_cast<float>(layer.layer)});
+        }
+    }
+
+    mesh.meshes.resize(arrayCount);
+    for (size_t array = 0; array < arrayCount; array++)
+    {
+        auto& renderData = mesh.meshes[array].renderData;
+        if (renderData.VAO == 0)
+        {
+            glGenBuffers(1, &renderData.posVBO);
+            glGenBuffers(1, &renderData.texVBO);
+            renderData.VAO = createPosTexLayerVAO(renderData.posVBO, renderData.texVBO);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, renderData.posVBO);
+        glBufferData(GL_ARRAY_BUFFER, positions[array].size() * sizeof(glm::vec2), positions[array].data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, renderData.texVBO);
+        glBufferData(GL_ARRAY_BUFFER, texCoords[array].size() * sizeof(glm::vec3), texCoords[array].data(), GL_STATIC_DRAW);
+        mesh.meshes[array].vertexCount = positions[array].size();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mesh.revision = chunk.revision;
+}
+
+void TileSystem::run(Registry &registry, float deltaTime)
+{
+    // Render tiles
 
     Render::setCamera(camera);
+    auto visible = Render::visibleBounds(*camera);
 
-    for (auto [tileEntity, pos, type, layer]: registry.each<glm::ivec2, TileType, Layer>())
+    // Ground tiles only change through the tilemap, so their meshes stay on the GPU until a chunk revision moves.
+    // Chunks outside the view are neither drawn nor rebuilt, an edit to them is picked up once they scroll in.
+    if (terrainMaterials.empty())
     {
-        Render::setLayer(layer.layer);
-        Render::setSubLayer(layer.layer == 2 ? pos.y : 0);
-        auto& atlasInfo = tileAtlasInfoMap[type];
-        unsigned int texture = getTexture(textureCatalog, atlasInfo.texture);
-        mat.name = atlasInfo.texture;
-        mat.texture = texture;
-        Render::setMaterial(mat);
-        Render::queue(toPosCoord(pos), toTextureCoord(atlasInfo.pos, atlasInfo.atlasSize));
+        for (size_t array = 0; array < terrainTextures->textures.size(); array++)
+        {
+            Render::Material mat;
+            mat.name = "Terrain " + std::to_string(array);
+            mat.shader = terrainShader;
+            mat.renderData = tileRenderData;
+            mat.texture = terrainTextures->textures[array];
+            terrainMaterials.push_back(Render::registerMaterial(mat));
+        }
     }
+    Render::setLayer(0);
+    Render::setSubLayer(0);
+    tilemap.forEachChunk([&](const glm::ivec2& chunkOrigin, const TileChunk& chunk)
+    {
+        Render::Bounds2D chunkBounds { chunkOrigin, chunkOrigin + glm::ivec2{TileChunkSize, TileChunkSize} };
+        if (!chunkBounds.intersects(visible))
+        {
+            return;
+        }
+        auto [cached, created] = chunkMeshes.try_emplace(&chunk);
+        auto& mesh = cached->second;
+        if (created || mesh.revision != chunk.revision)
+        {
+            buildChunkMesh(chunkOrigin, chunk, mesh);
+        }
+        for (size_t array = 0; array < mesh.meshes.size(); array++)
+        {
+            if (mesh.meshes[array].vertexCount > 0)
+            {
+                Render::setMaterial(terrainMaterials[array]);
+                Render::queueStatic(mesh.meshes[array]);
+            }
+        }
+    });
 
-    for (auto [tileEntity, pos, type, layer]: registry.each<glm::ivec2, DecoType, Layer>())
+    // Decoration sprites reach at most this many tiles past their position, so the grid query is padded by it
+    const glm::ivec2 decoReach {5, 5};
+    grid.forEachIn(glm::ivec2{glm::floor(visible.min)} - decoReach, glm::ivec2{glm::floor(visible.max)} + decoReach, [&](Entity decoEntity)
     {
+        if (!registry.has<DecoType>(decoEntity) || !registry.has<Layer>(decoEntity))
+        {
+            return;
+        }
+        auto& pos = registry.get<glm::ivec2>(decoEntity);
+        auto& type = registry.get<DecoType>(decoEntity);
+        auto& layer = registry.get<Layer>(decoEntity);
         auto& atlasInfo = decoAtlasInfoMap[type];
-        unsigned int texture = getTexture(textureCatalog, atlasInfo.texture);
-        mat.name = atlasInfo.texture;
-        mat.texture = texture;
+        Render::Bounds2D spriteBounds { glm::vec2{pos} + atlasInfo.spriteTranslate, glm::vec2{pos} + atlasInfo.spriteTranslate + atlasInfo.spriteSize };
+        if (!spriteBounds.intersects(visible))
+        {
+            return;
+        }
+        if (atlasInfo.material == Render::NoMaterial)
+        {
+            atlasInfo.material = spriteMaterial(atlasInfo.texture);
+        }
         Render::setLayer(layer.layer);
         Render::setSubLayer(layer.layer == 2 ? pos.y + atlasInfo.spriteSize.y + atlasInfo.spriteTranslate.y : 0); // TODO Check this
-        Render::setMaterial(mat);
-        auto posCoords = toPosCoord(pos, atlasInfo.spriteSize, atlasInfo.spriteTranslate);
-        auto texCoords = toTextureCoord(atlasInfo.pos, atlasInfo.atlasSize, atlasInfo.span);
-        Render::queue(posCoords, texCoords);
-    }     
+        Render::setMaterial(atlasInfo.material);
+        Render::queueSprite(glm::vec2{pos} + atlasInfo.spriteTranslate, atlasInfo.spriteSize, toTextureRect(atlasInfo.pos, atlasInfo.atlasSize, atlasInfo.span));
+    });
 
     {
-        unsigned int texture = getTexture(textureCatalog, "Cute_Fantasy_Free/Player/Player.png");
-        mat.name = "Cute_Fantasy_Free/Player/Player.png";
-        mat.texture = texture;
+        if (playerMaterial == Render::NoMaterial)
+        {
+            playerMaterial = spriteMaterial("Cute_Fantasy_Free/Player/Player.png");
+        }
         Render::setLayer(2);
         
+        const glm::vec2 characterSize {3, 3};
+        const glm::vec2 characterTranslate {-1.5f, -2.f};
         auto pos = registry.get<Pos>(george);
-        auto texCoords = toTextureCoord({1, 8}, {6, 10}, {1, 1});
-        auto posCoords = toPosCoord(pos, {3, 3}, {-1.5f, -2.f});
         Render::setSubLayer(pos.y);
-        Render::setMaterial(mat); // TODO Should this be reset by layer and sublayer?
-        Render::queue(posCoords, texCoords);
+        Render::setMaterial(playerMaterial); // TODO Should this be reset by layer and sublayer?
+        Render::queueSprite(pos + characterTranslate, characterSize, toTextureRect({1, 8}, {6, 10}, {1, 1}));
 
         pos = registry.get<Pos>(tink);
         auto animation = registry.get<AnimationState>(tink);
-        auto frame = animation.currentFrame;
-        glm::vec2 bottomLeft = frame.textureRegion.bottomLeft;
-        glm::vec2 bottomRight = { bottomLeft.x + frame.textureRegion.size.x, bottomLeft.y };
-        glm::vec2 topLeft = { bottomLeft.x, bottomLeft.y + frame.textureRegion.size.y };
-        glm::vec2 topRight = bottomLeft + frame.textureRegion.size;
-
-        texCoords = { bottomLeft, bottomRight, topRight, topRight, topLeft, bottomLeft };
-        posCoords = toPosCoord(pos, {3, 3}, {-1.5f, -2.f});
+        auto& region = animation.currentFrame.textureRegion;
         Render::setSubLayer(pos.y);
-        Render::setMaterial(mat); // TODO Should this be reset by layer and sublayer?
-        Render::queue(posCoords, texCoords);
+        Render::setMaterial(playerMaterial); // TODO Should this be reset by layer and sublayer?
+        Render::queueSprite(pos + characterTranslate, characterSize, glm::vec4{region.bottomLeft, region.bottomLeft + region.size});
     }
     Render::flush();
 }
 
 void DialogSystem::run(Registry& registry, float deltaTime)
 {
-    glUseProgram(unlitTextureShader);
+    if (textMaterial == Render::NoMaterial)
+    {
+        Render::Material mat;
+        mat.name = "Dialog text";
+        mat.shader = spriteShader;
+        mat.renderData = charRenderData;
+        mat.texture = getTexture(fontTextureCatalog, "ComicSans80/ComicSans80_0.png");
+        textMaterial = Render::registerMaterial(mat);
+    }
     Render::setCamera(camera);
-    auto comicSansTexture = getTexture(fontTextureCatalog, "ComicSans80/ComicSans80_0.png");
-    renderText(dialog, font, unlitTextureShader, comicSansTexture, charRenderData);
+    renderText(dialog, font, textMaterial);
 }
 
 void MissionSystem::run(Registry &registry, float deltaTime)
@@ -776,7 +926,7 @@ void MissionSystem::run(Registry &registry, float deltaTime)
 
 void AnimationSystem::run(Registry &registry, float deltaTime)
 {
-    for (auto [entity, animationState] : registry.each<AnimationState>())
+    parallelEach<AnimationState>(registry, threadPool, [&](Entity entity, AnimationState& animationState)
     {
         auto& animationSequence = getAnimation(catalog, animationState.animation);
         animationState.elapsedTime += deltaTime;
@@ -795,8 +945,7 @@ void AnimationSystem::run(Registry &registry, float deltaTime)
             accumulatedTime += frame.duration;
         }
         animationState.currentFrame = currentFrame;
-        registry.replace(entity, animationState);
-    }
+    });
 }
 
 void WoodGatheringSystem::run(Registry &registry, float deltaTime)
@@ -804,17 +953,16 @@ void WoodGatheringSystem::run(Registry &registry, float deltaTime)
     if ((gameState.mission != Missions::GATHER_WOOD && gameState.mission != Missions::GATHER_WOOD_AND_GLAZE) || gameState.woodGathered >= 5)
         return;
     auto& tinkPos = registry.get<Pos>(tink);
-    auto tiles = registry.each<DecoType>();
-    for (auto [woodEntity, _]: tiles)
+    std::atomic<int> gathered = 0;
+    parallelEach<glm::ivec2, DecoType>(registry, threadPool, commands, [&](CommandBuffer& chunkCommands, Entity woodEntity, glm::ivec2& pos, DecoType& type)
     {
-        auto type = registry.get<DecoType>(woodEntity);
-        auto pos = registry.get<glm::ivec2>(woodEntity);
         if (glm::length(tinkPos - glm::vec2{pos.x, pos.y}) < 1.1f && type == DecoType::WOOD)
         {
-            registry.remove(woodEntity);
-            gameState.woodGathered++;
+            chunkCommands.remove(woodEntity);
+            gathered++;
         }
-    }
+    });
+    gameState.woodGathered += gathered;
 }
 
 void ClayGatheringSystem::run(Registry &registry, float deltaTime)
@@ -822,15 +970,18 @@ void ClayGatheringSystem::run(Registry &registry, float deltaTime)
     if (gameState.mission != Missions::GATHER_CLAY || gameState.clayGathered >= 5)
         return;
     auto& tinkPos = registry.get<Pos>(tink);
-    auto tiles = registry.each<TileType>();
-    for (auto [clayEntity, _]: tiles)
+    // Only tiles within reach of Tink can be gathered, so look at the cells around Tink instead of the whole map
+    glm::ivec2 tinkTile {glm::floor(tinkPos)};
+    for (int y = tinkTile.y - 2; y <= tinkTile.y + 2; y++)
     {
-        auto type = registry.get<TileType>(clayEntity);
-        auto pos = registry.get<glm::ivec2>(clayEntity);
-        if (glm::length(tinkPos - glm::vec2{pos.x, pos.y}) < 1.1f && type == TileType::CLAY)
+        for (int x = tinkTile.x - 2; x <= tinkTile.x + 2; x++)
         {
-            registry.replace<TileType>(clayEntity, TileType::PATH);
-            gameState.clayGathered++;
+            glm::ivec2 pos {x, y};
+            if (glm::length(tinkPos - glm::vec2{pos.x, pos.y}) < 1.1f && tilemap.type(pos) == TileType::CLAY)
+            {
+                tilemap.setType(pos, TileType::PATH);
+                gameState.clayGathered++;
+            }
         }
     }
 }
@@ -840,15 +991,14 @@ void GlazeGatheringSystem::run(Registry &registry, float deltaTime)
     if (gameState.mission != Missions::GATHER_WOOD_AND_GLAZE || gameState.glazeGathered >= 5)
         return;
     auto& tinkPos = registry.get<Pos>(tink);
-    auto tiles = registry.each<DecoType>();
-    for (auto [glazeEntity, _]: tiles)
+    std::atomic<int> gathered = 0;
+    parallelEach<glm::ivec2, DecoType>(registry, threadPool, commands, [&](CommandBuffer& chunkCommands, Entity glazeEntity, glm::ivec2& pos, DecoType& type)
     {
-        auto type = registry.get<DecoType>(glazeEntity);
-        auto pos = registry.get<glm::ivec2>(glazeEntity);
         if (glm::length(tinkPos - glm::vec2{pos.x, pos.y}) < 1.1f && type == DecoType::GLAZE)
         {
-            registry.remove(glazeEntity);
-            gameState.glazeGathered++;
+            chunkCommands.remove(glazeEntity);
+            gathered++;
         }
-    }
+    });
+    gameState.glazeGathered += gathered;
 }
@@ -2,83 +2,20 @@
 
 #pragma once
 
+#include <filesystem>
+
 #include "ECS/ECS.h"
+#include "ECS/CommandBuffer.h"
+#include "ECS/SpatialGrid.h"
+#include "Jobs/ThreadPool.h"
 #include "Renderer/Renderer.h"
 #include "Catalog.h"
+#include "Decorations.h"
+#include "Tilemap.h"
 
 using Color = glm::vec4;
 using Pos = glm::vec2;
 
-enum class TileType
-{
-    UNSET = 0,
-    WATER,
-    GRASS,
-    PATH,
-    PATH_MINERAL_1,
-    PATH_MINERAL_2,
-    PATH_MINERAL_3,
-    GRASS_WATER_N,
-    GRASS_WATER_NE,
-    GRASS_WATER_E,
-    GRASS_WATER_SE,
-    GRASS_WATER_S,
-    GRASS_WATER_SW,
-    GRASS_WATER_W,
-    GRASS_WATER_NW,
-    GRASS_PATH_N,
-    GRASS_PATH_NE,
-    GRASS_PATH_E,
-    GRASS_PATH_SE,
-    GRASS_PATH_S,
-    GRASS_PATH_SW,
-    GRASS_PATH_W,
-    GRASS_PATH_NW,
-    PATH_GRASS_N,
-    PATH_GRASS_NE,
-    PATH_GRASS_E,
-    PATH_GRASS_SE,
-    PATH_GRASS_S,
-    PATH_GRASS_SW,
-    PATH_GRASS_W,
-    PATH_GRASS_NW,
-    PATH_WATER_N,
-    PATH_WATER_NE,
-    PATH_WATER_E,
-    PATH_WATER_SE,
-    PATH_WATER_S,
-    PATH_WATER_SW,
-    PATH_WATER_W,
-    PATH_WATER_NW,
-    WATER_GRASS_N,
-    WATER_GRASS_NE,
-    WATER_GRASS_E,
-    WATER_GRASS_SE,
-    WATER_GRASS_S,
-    WATER_GRASS_SW,
-    WATER_GRASS_W,
-    WATER_GRASS_NW,
-    WATER_PATH_N,
-    WATER_PATH_NE,
-    WATER_PATH_E,
-    WATER_PATH_SE,
-    WATER_PATH_S,
-    WATER_PATH_SW,
-    WATER_PATH_W,
-    WATER_PATH_NW,
-    CLAY,
-};
-
-enum class DecoType
-{
-    WOOD = 0,
-    GLAZE,
-    FLOWER,
-    OVEN,
-    BRIDGE_HOR,
-    BRIDGE_VER
-};
-
 enum Missions
 {
     START,
@@ -128,32 +65,40 @@ struct Layer
 
 struct Tree {};
 
-struct Blocked{};
-
 struct MovementSystem
 {
     void run(Registry &registry, float deltaTime);
     GameState& gameState;
+    Tilemap& tilemap;
     float speed = 4.f;
     Entity tink;
     Render::Camera* camera = nullptr;
 };
 
-void loadLevel(Registry& registry);
+/// Level file the editor saves to and the game starts from
+inline const std::filesystem::path LevelPath = "assets/levels/level.dat";
+
+void loadLevel(Registry& registry, Tilemap& tilemap, const std::filesystem::path& path = LevelPath);
+void saveLevel(Registry& registry, Tilemap& tilemap, const std::filesystem::path& path = LevelPath);
+/// Rewrites a level saved in the stream format used before LevelFile
+bool convertLegacyLevel(const std::filesystem::path& from, const std::filesystem::path& to = LevelPath);
 
 struct TileEditingSystem
 {
-    void selectTile(const glm::ivec2& nextSelectedPosition, Registry &registry);
-    TileType typeOfNeighbor(const glm::ivec2& neighbour, Registry& registry);
+    void selectTile(const glm::ivec2& nextSelectedPosition);
+    TileType typeOfNeighbor(const glm::ivec2& neighbour);
+    void placeDeco(Registry& registry, DecoType type);
     void run(Registry &registry, float deltaTime);
     GameState& gameState;
+    Tilemap& tilemap;
+    SpatialGrid& grid;
     RenderData lineRenderData;
     unsigned int unlitColorShader;
-    Entity selectedTile = 0;
     glm::ivec2 selectedPosition {-1, -1};
     TileType selectedTileType;
     Entity tink;
     Render::Camera* camera = nullptr;
+    std::array<Render::MaterialHandle, 3> gridMaterials { Render::NoMaterial, Render::NoMaterial, Render::NoMaterial };
 };
 
 struct AtlasInfo
@@ -164,23 +109,44 @@ struct AtlasInfo
     glm::ivec2 atlasSize; // TODO JH: Maybe move to texture info instead of AtlasInfo. Now duplicated a lot.
     glm::vec2 spriteSize = {1, 1};
     glm::vec2 spriteTranslate = {0, 0};
+    Render::MaterialHandle material = Render::NoMaterial;
 };
 
+/// Tiles of one chunk baked into a static mesh per terrain texture array, rebuilt when the chunk revision changes
+struct TileChunkMesh
+{
+    uint32_t revision = 0;
+    std::vector<Render::StaticMesh> meshes;
+};
+
+/// Textures the tiles are drawn with, to be loaded into the terrain texture arrays
+std::vector<std::string> terrainTextureNames();
+
 struct TileSystem
 {
     std::vector<glm::vec2> toTextureCoord(const glm::ivec2& tilePos, const glm::ivec2 tileCount, const glm::ivec2& span = {1, 1});
     std::vector<glm::vec2> toPosCoord(const glm::vec2& pos);
-    std::vector<glm::vec2> toPosCoord(const glm::vec2& pos, const glm::vec2& size, const glm::vec2& translation);
+    glm::vec4 toTextureRect(const glm::ivec2& tilePos, const glm::ivec2 tileCount, const glm::ivec2& span = {1, 1});
+
+    Render::MaterialHandle spriteMaterial(const std::string& texture);
+    void buildChunkMesh(const glm::ivec2& chunkOrigin, const TileChunk& chunk, TileChunkMesh& mesh);
 
     void run(Registry &registry, float deltaTime);
     GameState& gameState;
+    Tilemap& tilemap;
+    SpatialGrid& grid;
     TextureCatalog& textureCatalog;
-    unsigned int unlitTextureShader;
+    TextureArrays* terrainTextures = nullptr;
+    unsigned int terrainShader;
+    unsigned int spriteShader;
     unsigned int posBuffer;
     unsigned int texBuffer;
     RenderData tileRenderData;
     Entity tink, george;
     Render::Camera* camera = nullptr;
+    std::vector<Render::MaterialHandle> terrainMaterials;
+    Render::MaterialHandle playerMaterial = Render::NoMaterial;
+    std::unordered_map<const TileChunk*, TileChunkMesh> chunkMeshes;
 };
 
 struct DialogSystem
@@ -188,12 +154,13 @@ struct DialogSystem
     void run(Registry& registry, float deltaTime);
     BMFont& font;
     TextureCatalog& fontTextureCatalog;
-    unsigned int unlitTextureShader;
+    unsigned int spriteShader;
     unsigned int charTexBuffer;
     unsigned int comicSansTexture;
     RenderData charRenderData;
     std::string dialog = "";
     Render::Camera* camera = nullptr;
+    Render::MaterialHandle textMaterial = Render::NoMaterial;
 };
 
 struct MissionSystem
@@ -210,6 +177,7 @@ struct AnimationSystem
 {
     void run(Registry &registry, float deltaTime);
     AnimationCatalog& catalog;
+    ThreadPool& threadPool;
 };
 
 struct WoodGatheringSystem
@@ -217,6 +185,8 @@ struct WoodGatheringSystem
     void run(Registry &registry, float deltaTime);
     Entity tink;
     GameState& gameState;
+    ThreadPool& threadPool;
+    CommandBuffer commands;
 };
 
 struct ClayGatheringSystem
@@ -224,6 +194,7 @@ struct ClayGatheringSystem
     void run(Registry &registry, float deltaTime);
     Entity tink;
     GameState& gameState;
+    Tilemap& tilemap;
 };
 
 struct GlazeGatheringSystem
@@ -231,4 +202,6 @@ struct GlazeGatheringSystem
     void run(Registry &registry, float deltaTime);
     Entity tink;
     GameState& gameState;
+    ThreadPool& threadPool;
+    CommandBuffer commands;
 };
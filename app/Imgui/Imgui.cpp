@@ -7,6 +7,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Profiler/Profiler.h"
+
 namespace Imgui {
     
     struct Pos {
@@ -116,6 +118,14 @@ namespace Imgui {
         Theme theme = grey;
         int zOrder = 0;
         Render::Camera* camera = nullptr;
+        Render::MaterialHandle panelMaterial = Render::NoMaterial;
+        Render::MaterialHandle buttonMaterial = Render::NoMaterial;
+        Render::MaterialHandle buttonHoverMaterial = Render::NoMaterial;
+        Render::MaterialHandle buttonPressedMaterial = Render::NoMaterial;
+        std::unordered_map<unsigned int, Render::MaterialHandle> imageMaterials;
+        BMFont* font = nullptr;
+        unsigned int fontTexture = 0;
+        Render::MaterialHandle fontMaterial = Render::NoMaterial;
         GLFWcursorposfun prevCursorposCallback = nullptr;
         GLFWmousebuttonfun prevMousebuttonCallback = nullptr;
     };
@@ -138,13 +148,34 @@ namespace Imgui {
         return inBetween(pos.x, region.x, region.x + region.width) && inBetween(pos.y, region.y, region.y + region.height);
     }
 
+    Render::MaterialHandle registerColorMaterial(const std::string& name, const Color& color)
+    {
+        Render::Material material;
+        material.name = name;
+        material.shader = context.shaderId;
+        material.renderData = context.renderData;
+        material.uniform4fs["color"] = toVec4(color);
+        return Render::registerMaterial(material);
+    }
+
     void begin(unsigned int shaderId, unsigned int textureShaderId, RenderData renderData, Render::Camera* camera)
     {
+        PROFILE_ZONE("Imgui::begin");
+        bool shadersChanged = context.panelMaterial == Render::NoMaterial || context.shaderId != shaderId || context.textureShaderId != textureShaderId;
         context.shaderId = shaderId;
         context.textureShaderId = textureShaderId;
         context.renderData = renderData;
         context.zOrder = 0;
         context.camera = camera;
+        if (shadersChanged)
+        {
+            context.panelMaterial = registerColorMaterial("Imgui panel", context.theme.panelColor);
+            context.buttonMaterial = registerColorMaterial("Imgui button", context.theme.buttonColor);
+            context.buttonHoverMaterial = registerColorMaterial("Imgui button hover", context.theme.buttonHoverColor);
+            context.buttonPressedMaterial = registerColorMaterial("Imgui button pressed", context.theme.buttonPressedColor);
+            context.imageMaterials.clear();
+            context.fontMaterial = Render::NoMaterial;
+        }
         Render::flush();
         Render::printGLDebug("Rendering UI");
         Render::setCamera(context.camera);
@@ -152,6 +183,7 @@ namespace Imgui {
     
     void end()
     {
+        PROFILE_ZONE("Imgui::end");
         if (!context.mouseDown)
         {
             context.activeElement = "";
@@ -191,15 +223,10 @@ namespace Imgui {
         int width = 2*panel.padding + layout.width;
         int height = 2*panel.padding + panel.headerHeight + layout.height;
 
-        Render::Material material;
-        material.name = panel.name;
-        material.shader = context.shaderId;
-        material.renderData = context.renderData;
-        material.uniform4fs["color"] = toVec4(context.theme.panelColor);
         Render::setSubLayer(0);
-        Render::setMaterial(material);
+        Render::setMaterial(context.panelMaterial);
 
-        Render::queue({ {x, y}, {x + width, y}, {x + width, y + height}, {x + width, y + height}, {x, y + height}, {x, y} });
+        Render::queueSprite({x, y}, {width, height});
 
         context.currentPanel = "";
 
@@ -235,30 +262,6 @@ namespace Imgui {
         claimSpot(currentLayout.width, currentLayout.height);
     }
 
-    std::vector<glm::vec2> generateTriangulation(const glm::vec2& bottomLeft, const glm::vec2& size)
-    {
-        return {
-            { bottomLeft },
-            { bottomLeft + glm::vec2{ size.x, 0 } },
-            { bottomLeft + glm::vec2{ size.x, size.y } },
-            { bottomLeft + glm::vec2{ size.x, size.y } },
-            { bottomLeft + glm::vec2{ 0, size.y } },
-            { bottomLeft }
-        };
-    }
-
-    std::vector<glm::vec2> generateTriangulationUVs(const glm::vec2& bottomLeft, const glm::vec2& size)
-    {
-        return {
-            { bottomLeft + glm::vec2{ 0, size.y } },
-            { bottomLeft + size },
-            { bottomLeft + glm::vec2{ size.x, 0 } },
-            { bottomLeft + glm::vec2{ size.x, 0 } },
-            { bottomLeft },
-            { bottomLeft + glm::vec2{ 0, size.y } }
-        };
-    }
-
     bool button(const std::string& name, int width, int height)
     {
         auto mousePos = context.mousePos;
@@ -271,24 +274,18 @@ namespace Imgui {
             context.activeElement = name;
         }
         
-        Render::Material material;
-        material.name = name;
-        material.shader = context.shaderId;
-        material.renderData = context.renderData;
-        glm::vec4 color = toVec4(context.theme.buttonColor);
+        auto material = context.buttonMaterial;
         if (underMouse)
         {
-            color = toVec4(context.theme.buttonHoverColor);
+            material = context.buttonHoverMaterial;
         }
         if (context.activeElement == name)
         {
-            color = toVec4(context.theme.buttonPressedColor);
+            material = context.buttonPressedMaterial;
         }
-        material.uniform4fs["color"] = color;
         Render::setSubLayer(1);
         Render::setMaterial(material);
-        auto positions = generateTriangulation({x, y}, {width, height});
-        Render::queue(positions);
+        Render::queueSprite({x, y}, {width, height});
 
         return context.activeElement == name && underMouse && !context.mouseDown;
     }
@@ -305,21 +302,77 @@ namespace Imgui {
             context.activeElement = name;
         }
         
-        Render::Material material;
-        material.name = name;
-        material.shader = context.textureShaderId;
-        material.renderData = context.renderData;
-        material.texture = image;
+        auto [cached, created] = context.imageMaterials.try_emplace(image);
+        if (created)
+        {
+            Render::Material material;
+            material.name = "Imgui image " + std::to_string(image);
+            material.shader = context.textureShaderId;
+            material.renderData = context.renderData;
+            material.texture = image;
+            cached->second = Render::registerMaterial(material);
+        }
         Render::setSubLayer(1);
-        Render::setMaterial(material);
+        Render::setMaterial(cached->second);
 
-        auto positions = generateTriangulation({x, y}, {width, height});
-        auto texCoords = generateTriangulationUVs(frame.textureRegion.bottomLeft, frame.textureRegion.size);
-        Render::queue(positions, texCoords);
+        // The UI camera has y pointing down, so the frame is flipped vertically
+        auto& region = frame.textureRegion;
+        glm::vec4 uvRect { region.bottomLeft.x, region.bottomLeft.y + region.size.y, region.bottomLeft.x + region.size.x, region.bottomLeft.y };
+        Render::queueSprite({x, y}, {width, height}, uvRect);
 
         return context.activeElement == name && underMouse && !context.mouseDown;
     }
 
+    void setFont(BMFont* font, unsigned int texture)
+    {
+        context.font = font;
+        context.fontTexture = texture;
+        context.fontMaterial = Render::NoMaterial;
+    }
+
+    void label(const std::string& text, float scale)
+    {
+        if (!context.font)
+        {
+            return;
+        }
+        auto& font = *context.font;
+        float width = 0;
+        for (char letter : text)
+        {
+            width += font.chars[letter].xadvance * scale;
+        }
+        auto [x, y] = claimSpot(static_cast<int>(width), static_cast<int>(font.common.lineHeight * scale));
+
+        if (context.fontMaterial == Render::NoMaterial)
+        {
+            Render::Material material;
+            material.name = "Imgui font";
+            material.shader = context.textureShaderId;
+            material.renderData = context.renderData;
+            material.texture = context.fontTexture;
+            context.fontMaterial = Render::registerMaterial(material);
+        }
+        Render::setSubLayer(1);
+        Render::setMaterial(context.fontMaterial);
+
+        // Same glyph rectangles as renderText, the UI camera puts the top of a glyph at its position
+        glm::vec2 imageScale { 1.f / font.common.scaleW, 1.f / font.common.scaleH };
+        auto sh = font.common.scaleH;
+        float xadvance = 0;
+        for (char letter : text)
+        {
+            BMFontChar& ch = font.chars[letter];
+            glm::vec4 uvRect {
+                imageScale*glm::vec2{ch.x + 1, sh - (ch.y + 1)},
+                imageScale*glm::vec2{ch.x+ch.width - 1, sh - (ch.y + ch.height - 1)}
+            };
+            glm::vec2 pos { x + (xadvance + ch.xoffset) * scale, y + ch.yoffset * scale };
+            Render::queueSprite(pos, scale * glm::vec2{ch.width, ch.height}, uvRect);
+            xadvance += ch.xadvance;
+        }
+    }
+
     void cursorPosCallback(GLFWwindow* window, double xpos, double ypos)
     {
         context.mousePos = Pos{ static_cast<int>(xpos), static_cast<int>(ypos)};
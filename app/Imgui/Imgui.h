@@ -6,6 +6,7 @@
 
 #include "Renderer/Renderer.h"
 #include "Renderer/Textures.h"
+#include "FontRendering/BMFont.h"
 
 namespace Imgui {
 
@@ -28,6 +29,10 @@ namespace Imgui {
     void endLayout();
     bool button(const std::string& name, int width, int height);
     bool imageButton(const std::string& name, unsigned int image, const Frame& frame, int width, int height);
+    /// Font labels are written in, texture holds its page and is drawn with the texture shader passed to begin
+    void setFont(BMFont* font, unsigned int texture);
+    /// Single line of text at scale times the size of the font, draws nothing without a font
+    void label(const std::string& text, float scale = 0.25f);
 
     void installCallbacks(GLFWwindow* window);
 }
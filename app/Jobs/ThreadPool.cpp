@@ -0,0 +1,126 @@
+#include "Jobs/ThreadPool.h"
+
+namespace {
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local size_t currentQueueIndex = 0;
+}
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+{
+    // Queue 0 is shared by threads outside the pool, queue i + 1 belongs to worker i
+    for (unsigned int i = 0; i <= workerCount; i++)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned int i = 0; i < workerCount; i++)
+    {
+        m_threads.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::concurrency() const
+{
+    return m_threads.size() + 1;
+}
+
+void ThreadPool::submit(TaskGroup& group, std::function<void()> task)
+{
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+    auto& queue = *m_queues[currentQueue()];
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back({std::move(task), &group});
+    }
+    m_queued.fetch_add(1, std::memory_order_release);
+    {
+        // Taking the sleep mutex orders this wake up after a worker's last look at m_queued
+        std::lock_guard lock(m_sleepMutex);
+    }
+    m_wakeUp.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup& group)
+{
+    auto queueIndex = currentQueue();
+    while (group.pending.load(std::memory_order_acquire) > 0)
+    {
+        if (not runOne(queueIndex))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+size_t ThreadPool::currentQueue() const
+{
+    return currentPool == this ? currentQueueIndex : 0;
+}
+
+bool ThreadPool::pop(size_t queueIndex, Task& task)
+{
+    auto& queue = *m_queues[queueIndex];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty())
+    {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t queueIndex, Task& task)
+{
+    for (size_t i = 1; i < m_queues.size(); i++)
+    {
+        auto& queue = *m_queues[(queueIndex + i) % m_queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if (not queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runOne(size_t queueIndex)
+{
+    Task task;
+    if (not pop(queueIndex, task) && not steal(queueIndex, task))
+    {
+        return false;
+    }
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    task.function();
+    task.group->pending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t queueIndex)
+{
+    currentPool = this;
+    currentQueueIndex = queueIndex;
+    while (not m_stop)
+    {
+        if (not runOne(queueIndex))
+        {
+            std::unique_lock lock(m_sleepMutex);
+            m_wakeUp.wait(lock, [this] { return m_stop || m_queued.load(std::memory_order_acquire) > 0; });
+        }
+    }
+}
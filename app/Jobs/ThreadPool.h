@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Counts the unfinished tasks submitted under it, ThreadPool::wait blocks on it
+struct TaskGroup
+{
+    std::atomic<size_t> pending = 0;
+};
+
+/// Work-stealing thread pool. Every worker owns a task deque, pops its own newest task first
+/// and steals the oldest task of another queue when it runs dry. Threads outside the pool
+/// submit to a shared queue. Waiting threads execute tasks instead of blocking, so tasks may
+/// submit and wait on nested work.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(TaskGroup& group, std::function<void()> task);
+    void wait(TaskGroup& group);
+
+    /// Worker threads plus the waiting caller
+    size_t concurrency() const;
+
+private:
+    struct Task
+    {
+        std::function<void()> function;
+        TaskGroup* group = nullptr;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t queueIndex);
+    size_t currentQueue() const;
+    bool pop(size_t queueIndex, Task& task);
+    bool steal(size_t queueIndex, Task& task);
+    bool runOne(size_t queueIndex);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_queued = 0;
+    std::atomic<bool> m_stop = false;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeUp;
+};
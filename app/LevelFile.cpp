@@ -0,0 +1,240 @@
+#include "LevelFile.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace LevelFile
+{
+
+namespace {
+    uint64_t align(uint64_t value)
+    {
+        return (value + 15) & ~uint64_t{15};
+    }
+
+    /// Offsets of the arrays of a section relative to its start, and its size
+    struct TileChunkLayout
+    {
+        uint64_t origins;
+        uint64_t types;
+        uint64_t blocked;
+        uint64_t size;
+    };
+
+    TileChunkLayout tileChunkLayout(uint64_t count)
+    {
+        TileChunkLayout layout;
+        layout.origins = 0;
+        layout.types = align(count * sizeof(glm::ivec2));
+        layout.blocked = layout.types + align(count * TileChunkArea * sizeof(TileType));
+        layout.size = layout.blocked + count * BlockedWords * sizeof(uint64_t);
+        return layout;
+    }
+
+    struct DecorationLayout
+    {
+        uint64_t positions;
+        uint64_t types;
+        uint64_t layers;
+        uint64_t size;
+    };
+
+    DecorationLayout decorationLayout(uint64_t count)
+    {
+        DecorationLayout layout;
+        layout.positions = 0;
+        layout.types = align(count * sizeof(glm::ivec2));
+        layout.layers = layout.types + align(count * sizeof(uint32_t));
+        layout.size = layout.layers + count * sizeof(int32_t);
+        return layout;
+    }
+
+    template <typename T>
+    std::span<const T> array(const std::byte* base, uint64_t offset, size_t count)
+    {
+        return {reinterpret_cast<const T*>(base + offset), count};
+    }
+}
+
+std::span<const TileType, TileChunkArea> TileChunks::chunkTypes(size_t chunk) const
+{
+    return types.subspan(chunk * TileChunkArea).first<TileChunkArea>();
+}
+
+std::span<const uint64_t, BlockedWords> TileChunks::chunkBlocked(size_t chunk) const
+{
+    return blocked.subspan(chunk * BlockedWords).first<BlockedWords>();
+}
+
+bool Level::open(const std::filesystem::path& path)
+{
+    m_tileChunks = {};
+    m_decorations = {};
+    if (!m_file.open(path))
+    {
+        std::cerr << "Failed to map level " << path << std::endl;
+        return false;
+    }
+    auto fail = [&](const std::string& reason)
+    {
+        std::cerr << "Invalid level " << path << ": " << reason << std::endl;
+        m_file.close();
+        m_tileChunks = {};
+        m_decorations = {};
+        return false;
+    };
+
+    auto data = m_file.data();
+    auto size = m_file.size();
+    if (size < sizeof(Header))
+    {
+        return fail("truncated header");
+    }
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    if (header.magic != Magic)
+    {
+        return fail("not a level file");
+    }
+    if (header.version != Version)
+    {
+        return fail("unsupported version " + std::to_string(header.version));
+    }
+    if (sizeof(Header) + uint64_t{header.sectionCount} * sizeof(Section) > size)
+    {
+        return fail("truncated section table");
+    }
+
+    bool seenTileChunks = false;
+    bool seenDecorations = false;
+    for (auto& section : array<Section>(data, sizeof(Header), header.sectionCount))
+    {
+        uint64_t sectionSize = 0;
+        switch (section.kind)
+        {
+            case SectionKind::TileChunks:
+                sectionSize = tileChunkLayout(section.count).size;
+                break;
+            case SectionKind::Decorations:
+                sectionSize = decorationLayout(section.count).size;
+                break;
+            default:
+                continue;
+        }
+        if (section.offset % 16 != 0 || section.offset > size || sectionSize > size - section.offset)
+        {
+            return fail("section out of bounds");
+        }
+        auto base = data + section.offset;
+        if (section.kind == SectionKind::TileChunks)
+        {
+            if (seenTileChunks)
+            {
+                return fail("duplicate tile chunk section");
+            }
+            seenTileChunks = true;
+            auto layout = tileChunkLayout(section.count);
+            m_tileChunks.origins = array<glm::ivec2>(base, layout.origins, section.count);
+            m_tileChunks.types = array<TileType>(base, layout.types, section.count * TileChunkArea);
+            m_tileChunks.blocked = array<uint64_t>(base, layout.blocked, section.count * BlockedWords);
+            // Tilemap::setChunk takes the chunk containing the origin, an origin off the grid would shift the tiles
+            for (auto origin : m_tileChunks.origins)
+            {
+                if (origin.x % TileChunkSize != 0 || origin.y % TileChunkSize != 0)
+                {
+                    return fail("chunk origin off the chunk grid");
+                }
+            }
+            for (auto type : m_tileChunks.types)
+            {
+                if (static_cast<size_t>(type) >= TileTypeCount)
+                {
+                    return fail("unknown tile type " + std::to_string(static_cast<int>(type)));
+                }
+            }
+        }
+        else
+        {
+            if (seenDecorations)
+            {
+                return fail("duplicate decoration section");
+            }
+            seenDecorations = true;
+            auto layout = decorationLayout(section.count);
+            m_decorations.positions = array<glm::ivec2>(base, layout.positions, section.count);
+            m_decorations.types = array<uint32_t>(base, layout.types, section.count);
+            m_decorations.layers = array<int32_t>(base, layout.layers, section.count);
+            for (auto type : m_decorations.types)
+            {
+                if (type >= DecoTypeCount)
+                {
+                    return fail("unknown decoration type " + std::to_string(type));
+                }
+            }
+        }
+    }
+    return true;
+}
+
+const TileChunks& Level::tileChunks() const
+{
+    return m_tileChunks;
+}
+
+const Decorations& Level::decorations() const
+{
+    return m_decorations;
+}
+
+bool write(const std::filesystem::path& path, const LevelData& data)
+{
+    auto chunkCount = data.chunkOrigins.size();
+    auto decorationCount = data.decorationPositions.size();
+    if (data.chunkTypes.size() != chunkCount * TileChunkArea || data.chunkBlocked.size() != chunkCount * BlockedWords
+        || data.decorationTypes.size() != decorationCount || data.decorationLayers.size() != decorationCount)
+    {
+        std::cerr << "Level data for " << path << " has arrays of mismatching lengths" << std::endl;
+        return false;
+    }
+
+    // The whole file is assembled in memory and written at once, padding stays zero
+    auto tileLayout = tileChunkLayout(chunkCount);
+    auto decoLayout = decorationLayout(decorationCount);
+    std::array<Section, 2> sections;
+    uint64_t offset = align(sizeof(Header) + sections.size() * sizeof(Section));
+    sections[0] = {SectionKind::TileChunks, static_cast<uint32_t>(chunkCount), offset};
+    offset = align(offset + tileLayout.size);
+    sections[1] = {SectionKind::Decorations, static_cast<uint32_t>(decorationCount), offset};
+    offset = align(offset + decoLayout.size);
+
+    std::vector<std::byte> file(offset);
+    auto put = [&](uint64_t at, const void* source, size_t bytes)
+    {
+        if (bytes > 0)
+        {
+            std::memcpy(file.data() + at, source, bytes);
+        }
+    };
+    Header header { Magic, Version, static_cast<uint32_t>(sections.size()), 0 };
+    put(0, &header, sizeof(header));
+    put(sizeof(Header), sections.data(), sections.size() * sizeof(Section));
+    put(sections[0].offset + tileLayout.origins, data.chunkOrigins.data(), chunkCount * sizeof(glm::ivec2));
+    put(sections[0].offset + tileLayout.types, data.chunkTypes.data(), data.chunkTypes.size() * sizeof(TileType));
+    put(sections[0].offset + tileLayout.blocked, data.chunkBlocked.data(), data.chunkBlocked.size() * sizeof(uint64_t));
+    put(sections[1].offset + decoLayout.positions, data.decorationPositions.data(), decorationCount * sizeof(glm::ivec2));
+    put(sections[1].offset + decoLayout.types, data.decorationTypes.data(), decorationCount * sizeof(uint32_t));
+    put(sections[1].offset + decoLayout.layers, data.decorationLayers.data(), decorationCount * sizeof(int32_t));
+
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    out.write(reinterpret_cast<const char*>(file.data()), file.size());
+    if (!out)
+    {
+        std::cerr << "Failed to write level " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
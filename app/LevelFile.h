@@ -0,0 +1,102 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Decorations.h"
+#include "Platform.h"
+#include "Tilemap.h"
+
+/// Level files, read in place from a memory mapping. Little endian, every array starts on a 16 byte boundary.
+///   Header              magic "WCLV", version, section count
+///   Section[count]      kind, element count, offset of the section data from the start of the file
+///   section data
+/// TileChunks data is struct-of-arrays over the chunks: origins (tile position of the first cell of each chunk),
+/// types (TileChunkArea bytes per chunk) and blocked (TileChunkArea bits per chunk in 64 bit words).
+/// Decorations data is positions, types and layers. Sections of unknown kinds are skipped, so a later version
+/// may add sections without breaking older readers.
+namespace LevelFile
+{
+
+static_assert(std::endian::native == std::endian::little, "Level files are little endian and used in place");
+
+constexpr uint32_t Magic = 0x564c4357;
+constexpr uint32_t Version = 1;
+
+enum class SectionKind : uint32_t
+{
+    TileChunks = 1,
+    Decorations = 2
+};
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t reserved;
+};
+
+struct Section
+{
+    SectionKind kind;
+    uint32_t count;
+    uint64_t offset;
+};
+
+static_assert(sizeof(Header) == 16 && sizeof(Section) == 16);
+
+constexpr size_t BlockedWords = TileChunkArea / 64;
+
+struct TileChunks
+{
+    std::span<const glm::ivec2> origins;
+    std::span<const TileType> types;
+    std::span<const uint64_t> blocked;
+
+    std::span<const TileType, TileChunkArea> chunkTypes(size_t chunk) const;
+    std::span<const uint64_t, BlockedWords> chunkBlocked(size_t chunk) const;
+};
+
+struct Decorations
+{
+    std::span<const glm::ivec2> positions;
+    std::span<const uint32_t> types;
+    std::span<const int32_t> layers;
+};
+
+/// Mapped level file. The arrays point into the mapping and stay valid while the Level is open.
+class Level
+{
+public:
+    /// Maps path and checks the header, that every section lies within the file and appears once,
+    /// that chunk origins sit on the chunk grid and that tile and decoration types are known
+    bool open(const std::filesystem::path& path);
+
+    const TileChunks& tileChunks() const;
+    const Decorations& decorations() const;
+
+private:
+    MappedFile m_file;
+    TileChunks m_tileChunks;
+    Decorations m_decorations;
+};
+
+/// Contents of a level to write, the arrays of a section have one entry per element or per chunk like in the file
+struct LevelData
+{
+    std::vector<glm::ivec2> chunkOrigins;
+    std::vector<TileType> chunkTypes;
+    std::vector<uint64_t> chunkBlocked;
+    std::vector<glm::ivec2> decorationPositions;
+    std::vector<uint32_t> decorationTypes;
+    std::vector<int32_t> decorationLayers;
+};
+
+bool write(const std::filesystem::path& path, const LevelData& data);
+
+}
@@ -1,8 +1,35 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 #include <filesystem>
 
 std::string toLinuxStyle(const std::filesystem::path& p);
 
 std::string readFile(const std::string& path);
+
+/// Read-only memory mapping of a whole file, pages are read in by the OS as they are touched
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Maps path, fails for missing and empty files
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    const std::byte* data() const;
+    size_t size() const;
+
+private:
+    const std::byte* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
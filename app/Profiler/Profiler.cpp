@@ -0,0 +1,223 @@
+#include "Profiler/Profiler.h"
+
+#if PROFILER_ENABLED
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace Profiler
+{
+
+namespace {
+    struct Event
+    {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+        uint32_t depth;
+        uint32_t thread;
+    };
+
+    /// Zones closed on one thread. The owning thread is the only writer and publishes an event by moving head past it,
+    /// frameMark is the only reader and follows with tail. A writer more than RingSize events ahead overwrites
+    /// events the reader has not seen yet, those are detected after copying and dropped.
+    struct ThreadRing
+    {
+        static constexpr uint64_t RingSize = 1 << 14;
+        std::array<Event, RingSize> events;
+        std::atomic<uint64_t> head = 0;
+        uint64_t tail = 0;
+        uint32_t thread = 0;
+        uint32_t depth = 0;
+    };
+
+    /// Frames kept for writeChromeTrace
+    constexpr size_t HistoryFrames = 300;
+
+    struct Context
+    {
+        std::mutex ringsMutex;
+        std::vector<std::unique_ptr<ThreadRing>> rings;
+        uint64_t frameBegin = now();
+        std::vector<Event> frameEvents;
+        std::deque<std::vector<Event>> history;
+        std::vector<ZoneSummary> summary;
+        double frameMilliseconds = 0.0;
+        uint64_t droppedEvents = 0;
+    };
+
+    Context& context()
+    {
+        static Context instance;
+        return instance;
+    }
+
+    ThreadRing& threadRing()
+    {
+        thread_local ThreadRing* ring = []
+        {
+            auto& profiler = context();
+            std::lock_guard lock(profiler.ringsMutex);
+            auto& created = profiler.rings.emplace_back(std::make_unique<ThreadRing>());
+            created->thread = profiler.rings.size() - 1;
+            return created.get();
+        }();
+        return *ring;
+    }
+
+    void drain(ThreadRing& ring, std::vector<Event>& events, uint64_t& dropped)
+    {
+        // The writer may be filling the slot after head, so only the RingSize - 1 newest events are intact
+        auto head = ring.head.load(std::memory_order_acquire);
+        auto begin = std::max(ring.tail, head + 1 > ThreadRing::RingSize ? head + 1 - ThreadRing::RingSize : 0);
+        dropped += begin - ring.tail;
+        auto first = events.size();
+        for (auto i = begin; i < head; i++)
+        {
+            events.push_back(ring.events[i % ThreadRing::RingSize]);
+        }
+        ring.tail = head;
+        // Slots the writer reused while they were copied are dropped
+        auto written = ring.head.load(std::memory_order_acquire) + 1;
+        if (written > begin + ThreadRing::RingSize)
+        {
+            auto invalid = std::min(written - ThreadRing::RingSize - begin, head - begin);
+            events.erase(events.begin() + first, events.begin() + first + invalid);
+            dropped += invalid;
+        }
+    }
+
+    void summarize(Context& profiler)
+    {
+        auto& events = profiler.frameEvents;
+        std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.begin < b.begin; });
+        std::unordered_map<std::string_view, size_t> indices;
+        profiler.summary.clear();
+        for (auto& event : events)
+        {
+            auto [index, inserted] = indices.try_emplace(event.name, profiler.summary.size());
+            if (inserted)
+            {
+                profiler.summary.push_back({event.name, event.depth, 0, 0.0});
+            }
+            auto& zone = profiler.summary[index->second];
+            zone.depth = std::min(zone.depth, event.depth);
+            zone.calls++;
+            zone.milliseconds += (event.end - event.begin) / 1e6;
+        }
+    }
+
+    void writeEscaped(std::ostream& out, std::string_view text)
+    {
+        for (char ch : text)
+        {
+            if (ch == '"' || ch == '\\')
+            {
+                out << '\\';
+            }
+            out << ch;
+        }
+    }
+}
+
+uint64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Zone::Zone(const char* name)
+    : m_name(name)
+{
+    threadRing().depth++;
+    m_begin = now();
+}
+
+Zone::~Zone()
+{
+    auto end = now();
+    auto& ring = threadRing();
+    ring.depth--;
+    auto head = ring.head.load(std::memory_order_relaxed);
+    ring.events[head % ThreadRing::RingSize] = {m_name, m_begin, end, ring.depth, ring.thread};
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void frameMark()
+{
+    auto& profiler = context();
+    auto frameEnd = now();
+    profiler.frameEvents.clear();
+    {
+        std::lock_guard lock(profiler.ringsMutex);
+        for (auto& ring : profiler.rings)
+        {
+            drain(*ring, profiler.frameEvents, profiler.droppedEvents);
+        }
+    }
+    summarize(profiler);
+    profiler.frameMilliseconds = (frameEnd - profiler.frameBegin) / 1e6;
+    profiler.frameBegin = frameEnd;
+
+    profiler.history.push_back(profiler.frameEvents);
+    if (profiler.history.size() > HistoryFrames)
+    {
+        profiler.history.pop_front();
+    }
+}
+
+const std::vector<ZoneSummary>& lastFrame()
+{
+    return context().summary;
+}
+
+double lastFrameMilliseconds()
+{
+    return context().frameMilliseconds;
+}
+
+bool writeChromeTrace(const std::filesystem::path& path)
+{
+    auto& profiler = context();
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cerr << "Failed to open " << path << " for the profiler trace" << std::endl;
+        return false;
+    }
+    // Trace timestamps are microseconds, kept to the nanosecond
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (auto& frame : profiler.history)
+    {
+        for (auto& event : frame)
+        {
+            out << (first ? "" : ",") << "\n{\"name\":\"";
+            writeEscaped(out, event.name);
+            out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread
+                << ",\"ts\":" << event.begin / 1e3 << ",\"dur\":" << (event.end - event.begin) / 1e3 << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    if (profiler.droppedEvents > 0)
+    {
+        std::cerr << "Profiler dropped " << profiler.droppedEvents << " zones that overflowed a thread ring" << std::endl;
+    }
+    std::cerr << "Profiler trace written to " << path << std::endl;
+    return true;
+}
+
+}
+
+#endif
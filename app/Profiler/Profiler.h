@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+/// CPU zone profiler. PROFILE_ZONE(name) times the enclosing scope on the calling thread, zones nest.
+/// Each thread writes its zones into its own ring buffer without locking, frameMark collects them once per frame
+/// into a per-zone summary and a history of recent frames that writeChromeTrace exports.
+/// Builds without PROFILER_ENABLED compile the zones away and leave the functions below empty.
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 0
+#endif
+
+namespace Profiler
+{
+
+/// Time spent in all zones of one name during the last frame
+struct ZoneSummary
+{
+    const char* name;
+    /// Nesting depth of the outermost call, for indenting
+    uint32_t depth;
+    uint32_t calls;
+    double milliseconds;
+};
+
+#if PROFILER_ENABLED
+
+/// Nanoseconds since an arbitrary start, monotonic
+uint64_t now();
+
+class Zone
+{
+public:
+    /// name is kept by pointer and must stay valid until the frames holding the zone are exported
+    explicit Zone(const char* name);
+    ~Zone();
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_begin;
+};
+
+/// Ends the frame and collects the zones every thread closed during it.
+/// Zones still open are reported in the frame they close in.
+void frameMark();
+
+/// Zones of the last complete frame sorted by first occurrence, outer zones before the zones they contain
+const std::vector<ZoneSummary>& lastFrame();
+double lastFrameMilliseconds();
+
+/// Writes the zones of the recent frames as Chrome trace event JSON, viewable in chrome://tracing or Perfetto
+bool writeChromeTrace(const std::filesystem::path& path);
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ::Profiler::Zone PROFILER_CONCAT(profilerZone, __LINE__)(name)
+
+#else
+
+inline void frameMark()
+{
+}
+
+inline const std::vector<ZoneSummary>& lastFrame()
+{
+    static const std::vector<ZoneSummary> none;
+    return none;
+}
+
+inline double lastFrameMilliseconds()
+{
+    return 0.0;
+}
+
+inline bool writeChromeTrace(const std::filesystem::path&)
+{
+    return false;
+}
+
+#define PROFILE_ZONE(name)
+
+#endif
+
+}
@@ -15,4 +15,13 @@ namespace Render {
             return glm::ortho(-0.5f * maxFOV * ratio, 0.5f * maxFOV * ratio, -0.5f * maxFOV, 0.5f * maxFOV, near, far);
         }
     }
+
+    Bounds2D visibleBounds(const Camera& camera)
+    {
+        // The view only translates by the camera position, so unprojecting two opposite clip space corners is enough
+        auto inverseProjection = glm::inverse(camera.projection);
+        glm::vec2 cornerA = glm::vec2(inverseProjection * glm::vec4(-1.f, -1.f, 0.f, 1.f)) + camera.position;
+        glm::vec2 cornerB = glm::vec2(inverseProjection * glm::vec4(1.f, 1.f, 0.f, 1.f)) + camera.position;
+        return { glm::min(cornerA, cornerB), glm::max(cornerA, cornerB) };
+    }
 }
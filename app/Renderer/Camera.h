@@ -15,5 +15,20 @@ namespace Render {
         glm::vec2 resolution;
     };
     
+    /// Axis aligned rectangle in world units
+    struct Bounds2D
+    {
+        glm::vec2 min;
+        glm::vec2 max;
+
+        bool intersects(const Bounds2D& other) const
+        {
+            return min.x < other.max.x && other.min.x < max.x && min.y < other.max.y && other.min.y < max.y;
+        }
+    };
+
     glm::mat4 createProjection(const Size2D& resolution, float maxFOV, float near, float far);
+
+    /// Returns the part of the world the camera shows, anything outside can be skipped before queueing
+    Bounds2D visibleBounds(const Camera& camera);
 }
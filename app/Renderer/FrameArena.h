@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+/// Linear allocator for data that lives until the next reset. Allocations are offsets, so they stay valid when
+/// the arena grows. reset keeps the memory, after the first frames queueing data allocates nothing.
+class FrameArena
+{
+public:
+    /// Reserves size bytes and returns their offset, allocations start at multiples of 16
+    size_t allocate(size_t size)
+    {
+        auto offset = m_size;
+        auto end = offset + ((size + 15) & ~size_t{15});
+        if (end > m_capacity)
+        {
+            reserve(std::max(end, 2 * m_capacity));
+        }
+        m_size = end;
+        return offset;
+    }
+
+    std::byte* at(size_t offset)
+    {
+        return m_data.get() + offset;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    void reset()
+    {
+        m_size = 0;
+    }
+
+private:
+    void reserve(size_t capacity)
+    {
+        auto data = std::make_unique<std::byte[]>(capacity);
+        if (m_size > 0)
+        {
+            std::memcpy(data.get(), m_data.get(), m_size);
+        }
+        m_data = std::move(data);
+        m_capacity = capacity;
+    }
+
+    std::unique_ptr<std::byte[]> m_data;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+};
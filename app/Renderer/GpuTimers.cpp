@@ -0,0 +1,109 @@
+#include "Renderer/GpuTimers.h"
+
+#include <algorithm>
+#include <glad/glad.h>
+
+void GpuTimers::setEnabled(bool enabled)
+{
+    if (!enabled)
+    {
+        end();
+        for (auto& pool : m_pools)
+        {
+            pool.spans.clear();
+        }
+        m_lastFrame.clear();
+    }
+    m_enabled = enabled;
+}
+
+bool GpuTimers::enabled() const
+{
+    return m_enabled;
+}
+
+void GpuTimers::begin(int layer, uint32_t material)
+{
+    if (!m_enabled)
+    {
+        return;
+    }
+    end();
+    auto& pool = m_pools[m_frame];
+    if (pool.spans.size() == pool.queries.size())
+    {
+        unsigned int query;
+        glGenQueries(1, &query);
+        pool.queries.push_back(query);
+    }
+    auto query = pool.queries[pool.spans.size()];
+    pool.spans.push_back({query, layer, material});
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    m_open = true;
+}
+
+void GpuTimers::end()
+{
+    if (m_open)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_open = false;
+    }
+}
+
+void GpuTimers::endFrame()
+{
+    if (!m_enabled)
+    {
+        return;
+    }
+    end();
+    m_frame = (m_frame + 1) % FrameCount;
+    resolve(m_pools[m_frame]);
+}
+
+const std::vector<GpuTimers::Timing>& GpuTimers::lastFrame() const
+{
+    return m_lastFrame;
+}
+
+void GpuTimers::resolve(Pool& pool)
+{
+    if (pool.spans.empty())
+    {
+        return;
+    }
+    // Queries complete in order, the last one being available means all of them are
+    int available = 0;
+    glGetQueryObjectiv(pool.spans.back().query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available)
+    {
+        m_lastFrame.clear();
+        for (auto& span : pool.spans)
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(span.query, GL_QUERY_RESULT, &elapsed);
+            m_lastFrame.push_back({span.layer, span.material, elapsed / 1e6});
+        }
+        // A layer and material pair has a span per flush and per run of sublayers, they are reported summed
+        std::sort(m_lastFrame.begin(), m_lastFrame.end(), [](const Timing& a, const Timing& b)
+        {
+            return a.layer != b.layer ? a.layer < b.layer : a.material < b.material;
+        });
+        size_t merged = 0;
+        for (size_t i = 1; i < m_lastFrame.size(); i++)
+        {
+            auto& last = m_lastFrame[merged];
+            if (m_lastFrame[i].layer == last.layer && m_lastFrame[i].material == last.material)
+            {
+                last.milliseconds += m_lastFrame[i].milliseconds;
+            }
+            else
+            {
+                m_lastFrame[++merged] = m_lastFrame[i];
+            }
+        }
+        m_lastFrame.resize(merged + 1);
+    }
+    pool.spans.clear();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// GL_TIME_ELAPSED queries around spans of draws, each span tagged with a layer and a material handle.
+/// Spans never overlap, so the queries never nest. Every frame records into its own pool out of FrameCount
+/// and a pool is read back when its frame comes around again. Results that are still not available then
+/// are skipped, so reading never stalls the pipeline.
+class GpuTimers
+{
+public:
+    static constexpr size_t FrameCount = 3;
+
+    struct Timing
+    {
+        int layer;
+        uint32_t material;
+        double milliseconds;
+    };
+
+    /// Off by default, disabling ends the open span and forgets the pending pools
+    void setEnabled(bool enabled);
+    bool enabled() const;
+
+    /// Ends the open span and starts timing the following draws under layer and material
+    void begin(int layer, uint32_t material);
+    void end();
+
+    /// Reads back the pool this frame is about to reuse and moves on to it
+    void endFrame();
+
+    /// GPU time per layer and material of the latest frame read back, sorted by layer then material
+    const std::vector<Timing>& lastFrame() const;
+
+private:
+    struct Span
+    {
+        unsigned int query;
+        int layer;
+        uint32_t material;
+    };
+
+    struct Pool
+    {
+        std::vector<unsigned int> queries;
+        std::vector<Span> spans;
+    };
+
+    void resolve(Pool& pool);
+
+    bool m_enabled = false;
+    bool m_open = false;
+    size_t m_frame = 0;
+    std::array<Pool, FrameCount> m_pools;
+    std::vector<Timing> m_lastFrame;
+};
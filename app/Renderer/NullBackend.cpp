@@ -0,0 +1,348 @@
+#include "Renderer/NullBackend.h"
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+
+namespace NullBackend
+{
+
+namespace {
+    Stats currentStats;
+    GLuint nextName = 1;
+    uintptr_t nextSync = 1;
+    std::vector<std::unique_ptr<std::byte[]>> mappedBlocks;
+
+    /// Textures are counted as four bytes per texel whatever their format
+    constexpr uint64_t texelSize = 4;
+
+    void APIENTRY noop()
+    {
+    }
+
+    void APIENTRY genNames(GLsizei n, GLuint* names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+        {
+            names[i] = nextName++;
+        }
+    }
+
+    /// glCreateTextures and glCreateQueries take a target in front of the glGen arguments
+    void APIENTRY createNames(GLenum, GLsizei n, GLuint* names)
+    {
+        genNames(n, names);
+    }
+
+    GLuint APIENTRY createShader(GLenum)
+    {
+        return nextName++;
+    }
+
+    GLuint APIENTRY createProgram()
+    {
+        return nextName++;
+    }
+
+    const GLubyte* APIENTRY getString(GLenum name)
+    {
+        switch (name)
+        {
+            case GL_VERSION:
+                return reinterpret_cast<const GLubyte*>("4.6.0 Null");
+            case GL_SHADING_LANGUAGE_VERSION:
+                return reinterpret_cast<const GLubyte*>("4.60");
+            case GL_VENDOR:
+            case GL_RENDERER:
+                return reinterpret_cast<const GLubyte*>("Null");
+            default:
+                return reinterpret_cast<const GLubyte*>("");
+        }
+    }
+
+    const GLubyte* APIENTRY getStringi(GLenum, GLuint)
+    {
+        return reinterpret_cast<const GLubyte*>("");
+    }
+
+    void APIENTRY getIntegerv(GLenum name, GLint* data)
+    {
+        switch (name)
+        {
+            case GL_MAJOR_VERSION:
+                *data = 4;
+                break;
+            case GL_MINOR_VERSION:
+                *data = 6;
+                break;
+            case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:
+                *data = 256;
+                break;
+            default:
+                *data = 0;
+                break;
+        }
+    }
+
+    GLenum APIENTRY getError()
+    {
+        return GL_NO_ERROR;
+    }
+
+    void APIENTRY getShaderiv(GLuint, GLenum name, GLint* params)
+    {
+        *params = name == GL_COMPILE_STATUS ? GL_TRUE : 0;
+    }
+
+    void APIENTRY getProgramiv(GLuint, GLenum name, GLint* params)
+    {
+        // No active uniforms, so every location the renderer looks up is -1 and the uniform calls are ignored
+        *params = name == GL_LINK_STATUS ? GL_TRUE : 0;
+    }
+
+    GLint APIENTRY getUniformLocation(GLuint, const GLchar*)
+    {
+        return -1;
+    }
+
+    GLuint APIENTRY getUniformBlockIndex(GLuint, const GLchar*)
+    {
+        return GL_INVALID_INDEX;
+    }
+
+    void APIENTRY getQueryObjectiv(GLuint, GLenum, GLint* params)
+    {
+        // Results never become available, so GPU timers stay empty
+        *params = 0;
+    }
+
+    GLenum APIENTRY checkFramebufferStatus(GLenum)
+    {
+        return GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    void* mapBlock(GLsizeiptr length)
+    {
+        mappedBlocks.push_back(std::make_unique<std::byte[]>(length));
+        return mappedBlocks.back().get();
+    }
+
+    void* APIENTRY mapBufferRange(GLenum, GLintptr, GLsizeiptr length, GLbitfield)
+    {
+        return mapBlock(length);
+    }
+
+    void* APIENTRY mapNamedBufferRange(GLuint, GLintptr, GLsizeiptr length, GLbitfield)
+    {
+        return mapBlock(length);
+    }
+
+    GLboolean APIENTRY unmapBuffer(GLenum)
+    {
+        return GL_TRUE;
+    }
+
+    GLsync APIENTRY fenceSync(GLenum, GLbitfield)
+    {
+        return reinterpret_cast<GLsync>(nextSync++);
+    }
+
+    GLenum APIENTRY clientWaitSync(GLsync, GLbitfield, GLuint64)
+    {
+        return GL_ALREADY_SIGNALED;
+    }
+
+    void APIENTRY drawArrays(GLenum, GLint, GLsizei count)
+    {
+        currentStats.drawCalls++;
+        currentStats.instances++;
+        currentStats.vertices += count;
+    }
+
+    void APIENTRY drawElements(GLenum, GLsizei count, GLenum, const void*)
+    {
+        currentStats.drawCalls++;
+        currentStats.instances++;
+        currentStats.vertices += count;
+    }
+
+    void APIENTRY drawArraysInstanced(GLenum, GLint, GLsizei count, GLsizei instanceCount)
+    {
+        currentStats.drawCalls++;
+        currentStats.instances += instanceCount;
+        currentStats.vertices += static_cast<uint64_t>(count) * instanceCount;
+    }
+
+    void APIENTRY drawElementsInstanced(GLenum, GLsizei count, GLenum, const void*, GLsizei instanceCount)
+    {
+        currentStats.drawCalls++;
+        currentStats.instances += instanceCount;
+        currentStats.vertices += static_cast<uint64_t>(count) * instanceCount;
+    }
+
+    void upload(const void* data, uint64_t size)
+    {
+        if (data)
+        {
+            currentStats.bytesUploaded += size;
+        }
+    }
+
+    void APIENTRY bufferData(GLenum, GLsizeiptr size, const void* data, GLenum)
+    {
+        upload(data, size);
+    }
+
+    void APIENTRY bufferSubData(GLenum, GLintptr, GLsizeiptr size, const void* data)
+    {
+        upload(data, size);
+    }
+
+    void APIENTRY namedBufferData(GLuint, GLsizeiptr size, const void* data, GLenum)
+    {
+        upload(data, size);
+    }
+
+    void APIENTRY namedBufferStorage(GLuint, GLsizeiptr size, const void* data, GLbitfield)
+    {
+        upload(data, size);
+    }
+
+    void APIENTRY namedBufferSubData(GLuint, GLintptr, GLsizeiptr size, const void* data)
+    {
+        upload(data, size);
+    }
+
+    void APIENTRY texImage2D(GLenum, GLint, GLint, GLsizei width, GLsizei height, GLint, GLenum, GLenum, const void* pixels)
+    {
+        upload(pixels, texelSize * width * height);
+    }
+
+    void APIENTRY texSubImage2D(GLenum, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum, GLenum, const void* pixels)
+    {
+        upload(pixels, texelSize * width * height);
+    }
+
+    void APIENTRY textureSubImage2D(GLuint, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum, GLenum, const void* pixels)
+    {
+        upload(pixels, texelSize * width * height);
+    }
+
+    void APIENTRY textureSubImage3D(GLuint, GLint, GLint, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth, GLenum, GLenum, const void* pixels)
+    {
+        upload(pixels, texelSize * width * height * depth);
+    }
+
+    void APIENTRY stateChange()
+    {
+        currentStats.stateChanges++;
+    }
+
+    /// Entry points whose calls count as state changes, their arguments are never read.
+    /// Like noop they rely on the callee being free to ignore arguments, which holds for the cdecl and x64 conventions.
+    constexpr std::string_view stateChangeNames[] = {
+        "glActiveTexture",
+        "glBindBuffer",
+        "glBindBufferBase",
+        "glBindBufferRange",
+        "glBindFramebuffer",
+        "glBindTexture",
+        "glBindTextureUnit",
+        "glBindVertexArray",
+        "glBlendFunc",
+        "glDisable",
+        "glEnable",
+        "glUniform1f",
+        "glUniform1i",
+        "glUniform2f",
+        "glUniform3f",
+        "glUniform4f",
+        "glUniformMatrix4fv",
+        "glUseProgram",
+        "glViewport",
+    };
+
+    std::unordered_map<std::string_view, void*> createProcs()
+    {
+        std::unordered_map<std::string_view, void*> procs {
+            {"glGenBuffers", reinterpret_cast<void*>(&genNames)},
+            {"glGenVertexArrays", reinterpret_cast<void*>(&genNames)},
+            {"glGenTextures", reinterpret_cast<void*>(&genNames)},
+            {"glGenFramebuffers", reinterpret_cast<void*>(&genNames)},
+            {"glGenRenderbuffers", reinterpret_cast<void*>(&genNames)},
+            {"glGenQueries", reinterpret_cast<void*>(&genNames)},
+            {"glCreateBuffers", reinterpret_cast<void*>(&genNames)},
+            {"glCreateVertexArrays", reinterpret_cast<void*>(&genNames)},
+            {"glCreateFramebuffers", reinterpret_cast<void*>(&genNames)},
+            {"glCreateTextures", reinterpret_cast<void*>(&createNames)},
+            {"glCreateQueries", reinterpret_cast<void*>(&createNames)},
+            {"glCreateShader", reinterpret_cast<void*>(&createShader)},
+            {"glCreateProgram", reinterpret_cast<void*>(&createProgram)},
+            {"glGetString", reinterpret_cast<void*>(&getString)},
+            {"glGetStringi", reinterpret_cast<void*>(&getStringi)},
+            {"glGetIntegerv", reinterpret_cast<void*>(&getIntegerv)},
+            {"glGetError", reinterpret_cast<void*>(&getError)},
+            {"glGetShaderiv", reinterpret_cast<void*>(&getShaderiv)},
+            {"glGetProgramiv", reinterpret_cast<void*>(&getProgramiv)},
+            {"glGetUniformLocation", reinterpret_cast<void*>(&getUniformLocation)},
+            {"glGetUniformBlockIndex", reinterpret_cast<void*>(&getUniformBlockIndex)},
+            {"glGetQueryObjectiv", reinterpret_cast<void*>(&getQueryObjectiv)},
+            {"glCheckFramebufferStatus", reinterpret_cast<void*>(&checkFramebufferStatus)},
+            {"glMapBufferRange", reinterpret_cast<void*>(&mapBufferRange)},
+            {"glMapNamedBufferRange", reinterpret_cast<void*>(&mapNamedBufferRange)},
+            {"glUnmapBuffer", reinterpret_cast<void*>(&unmapBuffer)},
+            {"glFenceSync", reinterpret_cast<void*>(&fenceSync)},
+            {"glClientWaitSync", reinterpret_cast<void*>(&clientWaitSync)},
+            {"glDrawArrays", reinterpret_cast<void*>(&drawArrays)},
+            {"glDrawElements", reinterpret_cast<void*>(&drawElements)},
+            {"glDrawArraysInstanced", reinterpret_cast<void*>(&drawArraysInstanced)},
+            {"glDrawElementsInstanced", reinterpret_cast<void*>(&drawElementsInstanced)},
+            {"glBufferData", reinterpret_cast<void*>(&bufferData)},
+            {"glBufferSubData", reinterpret_cast<void*>(&bufferSubData)},
+            {"glNamedBufferData", reinterpret_cast<void*>(&namedBufferData)},
+            {"glNamedBufferStorage", reinterpret_cast<void*>(&namedBufferStorage)},
+            {"glNamedBufferSubData", reinterpret_cast<void*>(&namedBufferSubData)},
+            {"glTexImage2D", reinterpret_cast<void*>(&texImage2D)},
+            {"glTexSubImage2D", reinterpret_cast<void*>(&texSubImage2D)},
+            {"glTextureSubImage2D", reinterpret_cast<void*>(&textureSubImage2D)},
+            {"glTextureSubImage3D", reinterpret_cast<void*>(&textureSubImage3D)},
+        };
+        for (auto name : stateChangeNames)
+        {
+            procs[name] = reinterpret_cast<void*>(&stateChange);
+        }
+        return procs;
+    }
+}
+
+void* getProcAddress(const char* name)
+{
+    static const auto procs = createProcs();
+    auto proc = procs.find(name);
+    if (proc != procs.end())
+    {
+        return proc->second;
+    }
+    // Everything else returns nothing the renderer reads
+    return reinterpret_cast<void*>(&noop);
+}
+
+bool load()
+{
+    return gladLoadGLLoader(reinterpret_cast<GLADloadproc>(&getProcAddress)) != 0;
+}
+
+const Stats& stats()
+{
+    return currentStats;
+}
+
+void resetStats()
+{
+    currentStats = {};
+}
+
+}
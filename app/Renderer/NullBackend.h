@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+/// GL implementation that records what the renderer asks for instead of drawing it, for runs without a GPU.
+/// Loaded into glad in place of the driver, every entry point is a stub that at most updates the stats below.
+namespace NullBackend
+{
+
+struct Stats
+{
+    uint64_t drawCalls = 0;
+    uint64_t instances = 0;
+    uint64_t vertices = 0;
+    /// Bytes handed to buffer and texture uploads, writes into mapped buffers are not seen
+    uint64_t bytesUploaded = 0;
+    /// Binds, enables, blend state and uniform updates
+    uint64_t stateChanges = 0;
+};
+
+/// Resolves GL entry point names to the stubs, has the signature glad expects of a loader
+void* getProcAddress(const char* name);
+
+/// Points glad at the stubs, no context or window is needed afterwards
+[[nodiscard]] bool load();
+
+const Stats& stats();
+void resetStats();
+
+}
@@ -1,11 +1,19 @@
 #include "Renderer/Renderer.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <utility>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "Profiler/Profiler.h"
+
 bool operator==(const RenderData& renderDataA, const RenderData& renderDataB)
 {
     return renderDataA.VAO == renderDataB.VAO &&
@@ -16,7 +24,7 @@ bool operator==(const RenderData& renderDataA, const RenderData& renderDataB)
 
 unsigned int getLoc(unsigned int shader, const std::string& name)
 {
-    return glGetUniformLocation(shader, name.c_str());
+    return Render::uniformLocation(shader, Render::internUniform(name));
 }
 
 void setUniform(unsigned int shader, const std::string& name, int value)
@@ -34,18 +42,12 @@ void setUniform(unsigned int shader, const std::string& name, const glm::mat4& m
     glUniformMatrix4fv(getLoc(shader, name), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
-void renderText(const std::string& text, BMFont& font, unsigned int shader, unsigned int texture, RenderData& renderData)
+void renderText(const std::string& text, BMFont& font, Render::MaterialHandle material)
 {
     glm::vec2 imageScale { 1.f / font.common.scaleW, 1.f / font.common.scaleH };
     float xadvance = 0;
     float yadvance = 0;
     Render::printGLDebug("Rendering letters");
-    Render::Material material;
-    material.name = "Letter";
-    material.shader = shader;
-    material.uniformMatrix4fvs["view"] = glm::mat4(1.0f);
-    material.renderData = renderData;
-    material.texture = texture;
     Render::setMaterial(material);
     for (char letter : text)
     {
@@ -57,23 +59,13 @@ void renderText(const std::string& text, BMFont& font, unsigned int shader, unsi
         }
         BMFontChar& ch = font.chars[letter];
         auto sh = font.common.scaleH;
-        std::vector<glm::vec2> texCoords {
+        glm::vec4 uvRect {
             imageScale*glm::vec2{ch.x + 1, sh - (ch.y + 1)},
-            imageScale*glm::vec2{ch.x+ch.width - 1, sh - (ch.y + 1)},
-            imageScale*glm::vec2{ch.x+ch.width - 1, sh - (ch.y + ch.height - 1)},
-            imageScale*glm::vec2{ch.x+ch.width - 1, sh - (ch.y + ch.height - 1)},
-            imageScale*glm::vec2{ch.x + 1, sh - (ch.y + ch.height - 1)},
-            imageScale*glm::vec2{ch.x + 1, sh - (ch.y + 1)}
+            imageScale*glm::vec2{ch.x+ch.width - 1, sh - (ch.y + ch.height - 1)}
         };
-        
-        auto model = glm::translate(glm::mat4(1.0f), glm::vec3(xadvance + ch.xoffset, yadvance + ch.yoffset, 0.f));
-        model = glm::scale(model, glm::vec3((float)ch.width / font.common.lineHeight, (float)ch.height / font.common.lineHeight, 1.0));
-        auto posX = (float) xadvance + ch.xoffset;
-        auto posY = (float) yadvance + ch.yoffset;
-        auto width = (float)ch.width ;
-        auto height = (float)ch.height;
-        std::vector<glm::vec2> pos { {posX, posY}, {posX + width, posY}, {posX + width, posY + height}, {posX + width, posY + height}, {posX, posY + height}, {posX, posY}};
-        Render::queue(pos, texCoords);
+        glm::vec2 pos { xadvance + ch.xoffset, yadvance + ch.yoffset };
+        glm::vec2 size { ch.width, ch.height };
+        Render::queueSprite(pos, size, uvRect);
         xadvance += ch.xadvance;
     }
     Render::flush();
@@ -134,39 +126,351 @@ void renderText(const std::string& text, BMFont& font, unsigned int shader, unsi
     return VAO;
 }
 
+[[nodiscard]] unsigned int createPosTexLayerVAO(unsigned int posVBO, unsigned int texVBO)
+{
+    unsigned int VAO;
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    glVertexArrayVertexBuffer(VAO, 0, posVBO, 0, sizeof(glm::vec2));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glVertexArrayVertexBuffer(VAO, 1, texVBO, 0, sizeof(glm::vec3));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    return VAO;
+}
+
 namespace Render
 {
 
 RenderContext renderContext;
 
-bool operator==(const Material& matA, const Material& matB)
+/// Regions of the stream buffer start at this size and double when a frame needs more
+constexpr size_t streamRegionSize = 4 << 20;
+
+/// Vertex buffers are bound per draw, straight into the stream buffer
+[[nodiscard]] unsigned int createStreamVAO()
+{
+    unsigned int VAO;
+    glCreateVertexArrays(1, &VAO);
+    for (unsigned int attribute = 0; attribute < 2; attribute++)
+    {
+        glVertexArrayAttribFormat(VAO, attribute, 2, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(VAO, attribute, attribute);
+        glEnableVertexArrayAttrib(VAO, attribute);
+    }
+    return VAO;
+}
+
+[[nodiscard]] unsigned int createSpriteVAO()
 {
-    return matA.name == matB.name &&
-        matA.shader == matB.shader &&
-        matA.uniform1is == matB.uniform1is &&
-        matA.uniform4fs == matB.uniform4fs &&
-        matA.uniformMatrix4fvs == matB.uniformMatrix4fvs &&
-        matA.renderData == matB.renderData &&
-        matA.texture == matB.texture;
+    unsigned int VAO;
+    glCreateVertexArrays(1, &VAO);
+    glVertexArrayAttribFormat(VAO, 0, 2, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, position));
+    glVertexArrayAttribFormat(VAO, 1, 2, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, size));
+    glVertexArrayAttribFormat(VAO, 2, 4, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, uvRect));
+    for (unsigned int attribute = 0; attribute < 3; attribute++)
+    {
+        glVertexArrayAttribBinding(VAO, attribute, 0);
+        glEnableVertexArrayAttrib(VAO, attribute);
+    }
+    glVertexArrayBindingDivisor(VAO, 0, 1);
+    return VAO;
+}
+
+void initialize()
+{
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &renderContext.uniformBufferAlignment);
+    renderContext.stream.create(streamRegionSize);
+    renderContext.streamVAO = createStreamVAO();
+    renderContext.spriteVAO = createSpriteVAO();
+}
+
+void endFrame()
+{
+    renderContext.gpuTimers.endFrame();
+    renderContext.stream.endFrame();
+}
+
+void setGpuTimingEnabled(bool enabled)
+{
+    renderContext.gpuTimers.setEnabled(enabled);
+}
+
+const std::vector<GpuTiming>& gpuTimings()
+{
+    return renderContext.gpuTimers.lastFrame();
+}
+
+uint64_t streamedBytes()
+{
+    return renderContext.stream.bytesAllocated();
+}
+
+size_t BucketKeyHash::operator()(const BucketKey& key) const
+{
+    auto hash = std::hash<MaterialHandle>{}(key.material);
+    hash ^= std::hash<int>{}(key.layer) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<float>{}(key.subLayer) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+/// Header in front of queued data in the frame arena, the records of a bucket are chained through next
+struct Record
+{
+    enum Kind : uint32_t
+    {
+        Positions,
+        PositionTexCoords,
+        Sprites,
+        StaticMesh
+    };
+    uint32_t next;
+    Kind kind;
+    uint32_t count;
+    uint32_t padding;
+};
+static_assert(sizeof(Record) == 16, "Record payloads must stay 16 byte aligned");
+
+/// Packs what a bucket is sorted on into 64 bits, most significant first:
+/// layer (8 bits), sub layer (24 bits), shader slot (8 bits), texture slot (12 bits), material (12 bits).
+/// Sub layers keep the top 24 bits of an order preserving encoding of the float, nearly equal sub layers
+/// may tie and fall back to the state order.
+uint64_t sortKey(const Bucket& bucket)
+{
+    uint64_t layer = std::clamp(bucket.layer + 128, 0, 255);
+    auto subLayerBits = std::bit_cast<uint32_t>(bucket.subLayer);
+    subLayerBits = (subLayerBits & 0x80000000u) ? ~subLayerBits : subLayerBits | 0x80000000u;
+    uint64_t subLayer = subLayerBits >> 8;
+    return (layer << 56) | (subLayer << 32) | renderContext.materialStateKeys[bucket.material];
+}
+
+/// Stable least significant digit radix sort on the keys, one byte per pass.
+/// Passes where every key has the same byte are skipped, in practice most of them.
+void radixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch)
+{
+    scratch.resize(items.size());
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        std::array<size_t, 256> counts {};
+        for (auto& item : items)
+        {
+            counts[(item.key >> shift) & 0xff]++;
+        }
+        if (std::find(counts.begin(), counts.end(), items.size()) != counts.end())
+        {
+            continue;
+        }
+        size_t offset = 0;
+        for (auto& count : counts)
+        {
+            offset += std::exchange(count, offset);
+        }
+        for (auto& item : items)
+        {
+            scratch[counts[(item.key >> shift) & 0xff]++] = item;
+        }
+        items.swap(scratch);
+    }
+}
+
+Record& recordAt(uint32_t offset)
+{
+    return *reinterpret_cast<Record*>(renderContext.arena.at(offset));
+}
+
+/// Reserves count elements of kind in the active bucket, returns nullptr when no material is set or count is 0.
+/// When the newest record in the arena is the bucket's own record of the same kind it is extended in place,
+/// so runs of queue calls on one bucket are a single pointer bump each.
+std::byte* append(Record::Kind kind, uint32_t count, size_t elementSize)
+{
+    if (renderContext.activeBucket == NoBucket || count == 0)
+    {
+        return nullptr;
+    }
+    auto& arena = renderContext.arena;
+    auto& bucket = renderContext.buckets[renderContext.activeBucket];
+    auto bytes = count * elementSize;
+    if (bucket.lastRecord != NoRecord)
+    {
+        auto& last = recordAt(bucket.lastRecord);
+        auto lastBytes = last.count * elementSize;
+        if (last.kind == kind && lastBytes % 16 == 0 && bucket.lastRecord + sizeof(Record) + lastBytes == arena.size())
+        {
+            auto offset = arena.allocate(bytes);
+            recordAt(bucket.lastRecord).count += count;
+            return arena.at(offset);
+        }
+    }
+    uint32_t offset = arena.allocate(sizeof(Record) + bytes);
+    recordAt(offset) = {NoRecord, kind, count, 0};
+    if (bucket.lastRecord == NoRecord)
+    {
+        bucket.firstRecord = offset;
+    }
+    else
+    {
+        recordAt(bucket.lastRecord).next = offset;
+    }
+    bucket.lastRecord = offset;
+    return arena.at(offset + sizeof(Record));
+}
+
+UniformId internUniform(const std::string& name)
+{
+    return renderContext.uniformIds.try_emplace(name, renderContext.uniformIds.size()).first->second;
+}
+
+void reflectShader(unsigned int shader)
+{
+    auto& locations = renderContext.uniformLocations[shader];
+    int uniformCount = 0;
+    glGetProgramiv(shader, GL_ACTIVE_UNIFORMS, &uniformCount);
+    for (int i = 0; i < uniformCount; i++)
+    {
+        std::array<char, 256> name;
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(shader, i, name.size(), &length, &size, &type, name.data());
+        // Members of uniform blocks have no location
+        auto location = glGetUniformLocation(shader, name.data());
+        if (location < 0)
+        {
+            continue;
+        }
+        std::string uniformName(name.data(), length);
+        if (uniformName.ends_with("[0]"))
+        {
+            uniformName.resize(uniformName.size() - 3);
+        }
+        auto id = internUniform(uniformName);
+        if (locations.size() <= id)
+        {
+            locations.resize(id + 1, -1);
+        }
+        locations[id] = location;
+    }
+    auto cameraBlock = glGetUniformBlockIndex(shader, "Camera");
+    if (cameraBlock != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(shader, cameraBlock, CameraBlockBinding);
+    }
+}
+
+int uniformLocation(unsigned int shader, UniformId uniform)
+{
+    auto reflected = renderContext.uniformLocations.find(shader);
+    if (reflected == renderContext.uniformLocations.end())
+    {
+        reflectShader(shader);
+        reflected = renderContext.uniformLocations.find(shader);
+    }
+    auto& locations = reflected->second;
+    return uniform < locations.size() ? locations[uniform] : -1;
+}
+
+/// Slot a GL object name has or would get next, dense and small so it fits in a sort key
+uint32_t slotOf(const std::vector<unsigned int>& slots, unsigned int name)
+{
+    return std::find(slots.begin(), slots.end(), name) - slots.begin();
+}
+
+constexpr uint32_t shaderSlotBits = 8;
+constexpr uint32_t textureSlotBits = 12;
+constexpr uint32_t materialBits = 12;
+
+MaterialHandle registerMaterial(const Material& material)
+{
+    auto existing = renderContext.materialHandles.find(material.name);
+    auto handle = existing != renderContext.materialHandles.end() ? existing->second : static_cast<MaterialHandle>(renderContext.materials.size());
+    auto shaderSlot = slotOf(renderContext.shaderSlots, material.shader);
+    auto textureSlot = slotOf(renderContext.textureSlots, material.texture);
+    // A slot that does not fit its bits would share sort keys with another one and get batched with its draws
+    if (handle >= (1u << materialBits) || shaderSlot >= (1u << shaderSlotBits) || textureSlot >= (1u << textureSlotBits))
+    {
+        std::cerr << "Too many materials, shaders or textures to sort draws of " << material.name << ", not registering it" << std::endl;
+        return NoMaterial;
+    }
+    if (shaderSlot == renderContext.shaderSlots.size())
+    {
+        renderContext.shaderSlots.push_back(material.shader);
+    }
+    if (textureSlot == renderContext.textureSlots.size())
+    {
+        renderContext.textureSlots.push_back(material.texture);
+    }
+    bool created = existing == renderContext.materialHandles.end();
+    if (created)
+    {
+        renderContext.materialHandles.emplace(material.name, handle);
+    }
+    // Draws sort on the shader first, then the texture, then the material itself
+    uint32_t stateKey = (shaderSlot << (textureSlotBits + materialBits)) | (textureSlot << materialBits) | handle;
+    MaterialUniforms uniforms;
+    for (auto& [name, value] : material.uniform1is)
+    {
+        uniforms.uniform1is.emplace_back(uniformLocation(material.shader, internUniform(name)), value);
+    }
+    for (auto& [name, value] : material.uniform4fs)
+    {
+        uniforms.uniform4fs.emplace_back(uniformLocation(material.shader, internUniform(name)), value);
+    }
+    for (auto& [name, value] : material.uniformMatrix4fvs)
+    {
+        uniforms.uniformMatrix4fvs.emplace_back(uniformLocation(material.shader, internUniform(name)), value);
+    }
+    if (created)
+    {
+        renderContext.materials.push_back(material);
+        renderContext.materialUniforms.push_back(std::move(uniforms));
+        renderContext.materialStateKeys.push_back(stateKey);
+    }
+    else
+    {
+        renderContext.materials[handle] = material;
+        renderContext.materialUniforms[handle] = std::move(uniforms);
+        renderContext.materialStateKeys[handle] = stateKey;
+    }
+    return handle;
+}
+
+const Material& getMaterial(MaterialHandle material)
+{
+    return renderContext.materials[material];
 }
 
 void setLayer(int layer)
 {
     renderContext.activeLayer = layer;
     renderContext.activeSubLayer = 0;
-    renderContext.activeMaterial = {};
+    renderContext.activeMaterial = NoMaterial;
+    renderContext.activeBucket = NoBucket;
 }
 
 void setSubLayer(float subLayer)
 {
     renderContext.activeSubLayer = subLayer;
-    renderContext.activeMaterial = {};
+    renderContext.activeMaterial = NoMaterial;
+    renderContext.activeBucket = NoBucket;
 }
 
-void setMaterial(const Material& material)
+void setMaterial(MaterialHandle material)
 {
     renderContext.activeMaterial = material;
-    renderContext.layers[renderContext.activeLayer].subLayers[renderContext.activeSubLayer].materials[material.name] = material;
+    if (material == NoMaterial)
+    {
+        renderContext.activeBucket = NoBucket;
+        return;
+    }
+    BucketKey key { renderContext.activeLayer, renderContext.activeSubLayer, material };
+    auto [found, created] = renderContext.bucketIds.try_emplace(key, renderContext.buckets.size());
+    if (created)
+    {
+        renderContext.buckets.push_back({renderContext.activeLayer, renderContext.activeSubLayer, material});
+    }
+    renderContext.activeBucket = found->second;
 }
 
 void setCamera(Camera* camera)
@@ -212,18 +516,51 @@ void unsetFramebuffer()
 
 void queue(const std::vector<glm::vec2>& newPositions)
 {
-    auto& subLayer = renderContext.layers[renderContext.activeLayer].subLayers[renderContext.activeSubLayer];
-    auto& positions = subLayer.positions[renderContext.activeMaterial.name];
-    positions.insert(positions.end(), newPositions.begin(), newPositions.end());
+    if (auto data = append(Record::Positions, newPositions.size(), sizeof(glm::vec2)))
+    {
+        std::memcpy(data, newPositions.data(), newPositions.size() * sizeof(glm::vec2));
+        renderContext.buckets[renderContext.activeBucket].positionCount += newPositions.size();
+    }
 }
 
 void queue(const std::vector<glm::vec2>& newPositions, const std::vector<glm::vec2>& newTexCoords)
 {
-    auto& subLayer = renderContext.layers[renderContext.activeLayer].subLayers[renderContext.activeSubLayer];
-    auto& positions = subLayer.positions[renderContext.activeMaterial.name];
-    positions.insert(positions.end(), newPositions.begin(), newPositions.end());
-    auto& texCoords = subLayer.texCoords[renderContext.activeMaterial.name];
-    texCoords.insert(texCoords.end(), newTexCoords.begin(), newTexCoords.end());
+    if (newPositions.size() != newTexCoords.size())
+    {
+        std::cerr << "Queued " << newPositions.size() << " positions with " << newTexCoords.size() << " texture coordinates, skipping them" << std::endl;
+        return;
+    }
+    // Positions and texture coordinates share one interleaved record, so runs of quads keep extending it in place
+    if (auto data = append(Record::PositionTexCoords, newPositions.size(), 2 * sizeof(glm::vec2)))
+    {
+        auto vertices = reinterpret_cast<glm::vec2*>(data);
+        for (size_t i = 0; i < newPositions.size(); i++)
+        {
+            vertices[2 * i] = newPositions[i];
+            vertices[2 * i + 1] = newTexCoords[i];
+        }
+        auto& bucket = renderContext.buckets[renderContext.activeBucket];
+        bucket.positionCount += newPositions.size();
+        bucket.hasTexCoords = true;
+    }
+}
+
+void queueStatic(const StaticMesh& mesh)
+{
+    if (auto data = append(Record::StaticMesh, 1, sizeof(StaticMesh)))
+    {
+        std::memcpy(data, &mesh, sizeof(StaticMesh));
+    }
+}
+
+void queueSprite(const glm::vec2& position, const glm::vec2& size, const glm::vec4& uvRect)
+{
+    if (auto data = append(Record::Sprites, 1, sizeof(SpriteInstance)))
+    {
+        SpriteInstance sprite {position, size, uvRect};
+        std::memcpy(data, &sprite, sizeof(SpriteInstance));
+        renderContext.buckets[renderContext.activeBucket].spriteCount++;
+    }
 }
 
 void printGLDebug(const std::string& message)
@@ -233,61 +570,183 @@ void printGLDebug(const std::string& message)
 
 void flush()
 {
+    PROFILE_ZONE("Render::flush");
     auto camera = renderContext.activeCamera;
     if (not camera)
     {
         std::cerr << "No active camera, can't render" << std::endl;
         return;
     }
-    for (auto& [layerNumber, layer] : renderContext.layers)
+    auto& buckets = renderContext.buckets;
+    auto& drawItems = renderContext.drawItems;
+    drawItems.resize(buckets.size());
+    for (uint32_t i = 0; i < buckets.size(); i++)
+    {
+        drawItems[i] = {sortKey(buckets[i]), i};
+    }
+    radixSort(drawItems, renderContext.sortScratch);
+
+    // The camera matrices go through the stream buffer once per flush, every shader reads them from the Camera block
+    glm::vec3 camPos3 { camera->position.x, camera->position.y, 0.f };
+    std::array<glm::mat4, 2> cameraBlock { camera->projection, glm::translate(glm::mat4(1.0f), -camPos3) };
+
+    // Growing the stream buffer replaces it, which would unbind the Camera block in the middle of the flush.
+    // Everything the flush streams is reserved up front instead, with room for the alignment of each allocation.
+    size_t streamBytes = sizeof(cameraBlock) + renderContext.uniformBufferAlignment - 1;
+    for (auto& bucket : buckets)
+    {
+        auto bytes = bucket.spriteCount * sizeof(SpriteInstance) + (bucket.hasTexCoords ? 2 : 1) * bucket.positionCount * sizeof(glm::vec2);
+        if (bytes > 0)
+        {
+            streamBytes += bytes + 15;
+        }
+    }
+    renderContext.stream.reserve(streamBytes);
+    auto cameraAllocation = renderContext.stream.allocate(sizeof(cameraBlock), renderContext.uniformBufferAlignment);
+    std::memcpy(cameraAllocation.data, cameraBlock.data(), sizeof(cameraBlock));
+    glBindBufferRange(GL_UNIFORM_BUFFER, CameraBlockBinding, renderContext.stream.handle(), cameraAllocation.offset, sizeof(cameraBlock));
+
+    // Only changes in state are sent to GL, the sort order groups draws sharing a shader or texture
+    int currentLayer = 0;
+    float currentSubLayer = 0;
+    unsigned int currentShader = 0;
+    unsigned int currentTexture = 0;
+    MaterialHandle currentMaterial = NoMaterial;
+    for (size_t i = 0; i < drawItems.size(); i++)
     {
-        printGLDebug(std::string("Layer ") + std::to_string(layerNumber));
-        for (auto& [subLayerNumber, subLayer] : layer.subLayers)
+        auto& bucket = buckets[drawItems[i].bucket];
+        auto& material = renderContext.materials[bucket.material];
+        bool newLayer = i == 0 || currentLayer != bucket.layer;
+        if (newLayer)
+        {
+            printGLDebug(std::string("Layer ") + std::to_string(bucket.layer));
+        }
+        if (newLayer || currentSubLayer != bucket.subLayer)
+        {
+            printGLDebug(std::string("SubLayer ") + std::to_string(bucket.subLayer));
+        }
+        if (newLayer || bucket.material != buckets[drawItems[i - 1].bucket].material)
+        {
+            renderContext.gpuTimers.begin(bucket.layer, bucket.material);
+        }
+        currentLayer = bucket.layer;
+        currentSubLayer = bucket.subLayer;
+        printGLDebug(std::string("Material ") + material.name);
+        if (i == 0 || material.shader != currentShader)
         {
-            printGLDebug(std::string("SubLayer ") + std::to_string(subLayerNumber));
-            for (auto& [materialName, material] : subLayer.materials)
+            currentShader = material.shader;
+            glUseProgram(material.shader);
+            currentMaterial = NoMaterial;
+        }
+        if (bucket.material != currentMaterial)
+        {
+            currentMaterial = bucket.material;
+            auto& uniforms = renderContext.materialUniforms[bucket.material];
+            for (auto& [location, value] : uniforms.uniform1is)
             {
-                printGLDebug(std::string("Material ") + materialName);
-                glUseProgram(material.shader);
-                setUniform(material.shader, "projection", camera->projection);
-                glm::vec3 camPos3 { camera->position.x, camera->position.y, 0.f };
-                auto view = glm::translate(glm::mat4(1.0f), -camPos3);
-                setUniform(material.shader, "view", view);
-                for (auto& [uniformName, value] : material.uniform1is)
-                {
-                    setUniform(material.shader, uniformName, value);
-                }
-                for (auto& [uniformName, value] : material.uniform4fs)
-                {
-                    setUniform(material.shader, uniformName, value);
-                }
-                for (auto& [uniformName, value] : material.uniformMatrix4fvs)
+                glUniform1i(location, value);
+            }
+            for (auto& [location, value] : uniforms.uniform4fs)
+            {
+                glUniform4f(location, value.x, value.y, value.z, value.w);
+            }
+            for (auto& [location, value] : uniforms.uniformMatrix4fvs)
+            {
+                glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+            }
+        }
+        if (i == 0 || material.texture != currentTexture)
+        {
+            currentTexture = material.texture;
+            // Binds to the target the texture was created with, 2D textures and texture arrays alike
+            glBindTextureUnit(0, material.texture);
+        }
+
+        // Static meshes are drawn while walking the records, the streamed data of the bucket is gathered into
+        // one stream allocation: sprites first, then positions and texture coordinates.
+        auto spriteBytes = bucket.spriteCount * sizeof(SpriteInstance);
+        auto positionBytes = bucket.positionCount * sizeof(glm::vec2);
+        // Every position gets a texture coordinate once the bucket has any, so both ranges line up vertex for vertex
+        auto texCoordBytes = bucket.hasTexCoords ? positionBytes : 0;
+        StreamBuffer::Allocation allocation;
+        if (spriteBytes + positionBytes + texCoordBytes > 0)
+        {
+            allocation = renderContext.stream.allocate(spriteBytes + positionBytes + texCoordBytes, 16);
+        }
+        std::array<size_t, 3> written { 0, spriteBytes, spriteBytes + positionBytes };
+        for (auto offset = bucket.firstRecord; offset != NoRecord; offset = recordAt(offset).next)
+        {
+            auto& record = recordAt(offset);
+            auto payload = renderContext.arena.at(offset + sizeof(Record));
+            auto copy = [&](size_t& target, size_t elementSize)
+            {
+                std::memcpy(allocation.data + target, payload, record.count * elementSize);
+                target += record.count * elementSize;
+            };
+            switch (record.kind)
+            {
+                case Record::Sprites:
+                    copy(written[0], sizeof(SpriteInstance));
+                    break;
+                case Record::Positions:
+                    if (bucket.hasTexCoords)
+                    {
+                        std::memset(allocation.data + written[2], 0, record.count * sizeof(glm::vec2));
+                        written[2] += record.count * sizeof(glm::vec2);
+                    }
+                    copy(written[1], sizeof(glm::vec2));
+                    break;
+                case Record::PositionTexCoords:
                 {
-                    setUniform(material.shader, uniformName, value);
+                    // Split back into the position and texture coordinate ranges the stream VAO reads
+                    auto vertices = reinterpret_cast<const glm::vec2*>(payload);
+                    auto positions = reinterpret_cast<glm::vec2*>(allocation.data + written[1]);
+                    auto texCoords = reinterpret_cast<glm::vec2*>(allocation.data + written[2]);
+                    for (uint32_t vertex = 0; vertex < record.count; vertex++)
+                    {
+                        positions[vertex] = vertices[2 * vertex];
+                        texCoords[vertex] = vertices[2 * vertex + 1];
+                    }
+                    written[1] += record.count * sizeof(glm::vec2);
+                    written[2] += record.count * sizeof(glm::vec2);
+                    break;
                 }
-                
-                glBindVertexArray(material.renderData.VAO);
-
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, material.texture);
-                
-                auto& positions = subLayer.positions[material.name];
-                glBindBuffer(GL_ARRAY_BUFFER, material.renderData.posVBO);
-                glBufferData(GL_ARRAY_BUFFER, positions.size()*sizeof(glm::vec2), &positions[0], GL_DYNAMIC_DRAW);
-                
-                auto& texCoords = subLayer.texCoords[material.name];
-
-                if (texCoords.size() > 0)
+                case Record::StaticMesh:
                 {
-                    glBindBuffer(GL_ARRAY_BUFFER, material.renderData.texVBO);
-                    glBufferData(GL_ARRAY_BUFFER, texCoords.size()*sizeof(glm::vec2), &texCoords[0], GL_DYNAMIC_DRAW);
+                    StaticMesh mesh;
+                    std::memcpy(&mesh, payload, sizeof(StaticMesh));
+                    glBindVertexArray(mesh.renderData.VAO);
+                    glDrawArrays(mesh.renderData.drawMode, 0, mesh.vertexCount);
+                    break;
                 }
-                
-                glDrawArrays(material.renderData.drawMode, 0, positions.size());
             }
         }
+
+        if (bucket.spriteCount > 0)
+        {
+            glBindVertexArray(renderContext.spriteVAO);
+            glVertexArrayVertexBuffer(renderContext.spriteVAO, 0, renderContext.stream.handle(), allocation.offset, sizeof(SpriteInstance));
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, bucket.spriteCount);
+        }
+
+        if (bucket.positionCount > 0)
+        {
+            // Shaders without texture coordinates still get a valid range on the second binding
+            auto positionOffset = allocation.offset + spriteBytes;
+            auto texCoordOffset = bucket.hasTexCoords ? positionOffset + positionBytes : positionOffset;
+            glBindVertexArray(renderContext.streamVAO);
+            glVertexArrayVertexBuffer(renderContext.streamVAO, 0, renderContext.stream.handle(), positionOffset, sizeof(glm::vec2));
+            glVertexArrayVertexBuffer(renderContext.streamVAO, 1, renderContext.stream.handle(), texCoordOffset, sizeof(glm::vec2));
+            glDrawArrays(material.renderData.drawMode, 0, bucket.positionCount);
+        }
     }
-    renderContext.layers = {};
+    renderContext.gpuTimers.end();
+
+    // Keep the memory for the next frame, only the contents are dropped
+    renderContext.arena.reset();
+    renderContext.buckets.clear();
+    renderContext.bucketIds.clear();
+    renderContext.activeBucket = NoBucket;
 }
 
 }
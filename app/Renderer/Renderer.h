@@ -1,10 +1,18 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
+#include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "Renderer/Camera.h"
+#include "Renderer/FrameArena.h"
+#include "Renderer/GpuTimers.h"
+#include "Renderer/StreamBuffer.h"
 #include "FontRendering/BMFont.h"
 
 struct RenderData
@@ -26,12 +34,13 @@ unsigned int getLoc(unsigned int shader, const std::string& name);
 void setUniform(unsigned int shader, const std::string& name, int value);
 void setUniform(unsigned int shader, const std::string& name, const glm::vec4& vec);
 void setUniform(unsigned int shader, const std::string& name, const glm::mat4& mat);
-void renderText(const std::string& text, BMFont& font, unsigned int shader, unsigned int texture, RenderData& renderData);
 
 [[nodiscard]] BufferData bufferData(const std::vector<glm::vec2>& data) ;
 [[nodiscard]] BufferData bufferIndexData(const std::vector<unsigned int>& data);
 [[nodiscard]] unsigned int createPosVAO(unsigned int posVBO, unsigned int ebo = 0);
 [[nodiscard]] unsigned int createPosTexVAO(unsigned int posVBO, unsigned int texVBO, unsigned int ebo = 0);
+/// Like createPosTexVAO with glm::vec3 texture coordinates, the third one selects the layer of a texture array
+[[nodiscard]] unsigned int createPosTexLayerVAO(unsigned int posVBO, unsigned int texVBO);
 
 namespace Render
 {
@@ -39,26 +48,78 @@ namespace Render
 struct Material
 {
     std::string name;
-    unsigned int shader;
+    unsigned int shader = 0;
     std::map<std::string, int> uniform1is;
     std::map<std::string, glm::vec4> uniform4fs;
     std::map<std::string, glm::mat4> uniformMatrix4fvs;
     RenderData renderData;
-    unsigned int texture;
+    unsigned int texture = 0;
 };
 
-bool operator==(const Material& matA, const Material& matB);
+/// Interned uniform name, see internUniform
+using UniformId = uint32_t;
 
-struct SubLayer
+/// Uniform block every shader reads the camera matrices from, bound once per flush
+constexpr unsigned int CameraBlockBinding = 0;
+
+/// Uniform values of a registered material with their locations already looked up
+struct MaterialUniforms
+{
+    std::vector<std::pair<int, int>> uniform1is;
+    std::vector<std::pair<int, glm::vec4>> uniform4fs;
+    std::vector<std::pair<int, glm::mat4>> uniformMatrix4fvs;
+};
+
+/// Index of a material registered with registerMaterial
+using MaterialHandle = uint32_t;
+constexpr MaterialHandle NoMaterial = std::numeric_limits<MaterialHandle>::max();
+
+/// Vertex data that already lives on the GPU, drawn as is by flush
+struct StaticMesh
+{
+    RenderData renderData;
+    size_t vertexCount = 0;
+};
+
+/// One textured quad drawn by an instanced draw, the vertex shader expands it into two triangles.
+/// uvRect holds the texture coordinate at position in xy and the one at position + size in zw.
+struct SpriteInstance
+{
+    glm::vec2 position;
+    glm::vec2 size;
+    glm::vec4 uvRect;
+};
+
+constexpr uint32_t NoBucket = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t NoRecord = std::numeric_limits<uint32_t>::max();
+
+/// Everything queued with one material in one layer and sub layer, flush draws it together.
+/// The queued data is a chain of records in the frame arena, starting at firstRecord.
+struct Bucket
+{
+    int layer = 0;
+    float subLayer = 0;
+    MaterialHandle material = NoMaterial;
+    uint32_t firstRecord = NoRecord;
+    uint32_t lastRecord = NoRecord;
+    uint32_t positionCount = 0;
+    /// Set once any queued vertices carry texture coordinates, vertices queued without them then get zeroed ones
+    bool hasTexCoords = false;
+    uint32_t spriteCount = 0;
+};
+
+struct BucketKey
 {
-    std::unordered_map<std::string, std::vector<glm::vec2>> positions;
-    std::unordered_map<std::string, std::vector<glm::vec2>> texCoords;
-    std::unordered_map<std::string, Material> materials;
+    int layer;
+    float subLayer;
+    MaterialHandle material;
+
+    bool operator==(const BucketKey& other) const = default;
 };
 
-struct Layer
+struct BucketKeyHash
 {
-    std::map<float, SubLayer> subLayers;
+    size_t operator()(const BucketKey& key) const;
 };
 
 struct Framebuffer
@@ -68,26 +129,80 @@ struct Framebuffer
     glm::ivec2 pixelSize;
 };
 
+/// Bucket to draw with the key it is sorted on, see sortKey in Renderer.cpp for the bit layout
+struct DrawItem
+{
+    uint64_t key;
+    uint32_t bucket;
+};
+
 struct RenderContext
 {
-    std::map<int, Layer> layers;
+    std::unordered_map<std::string, UniformId> uniformIds;
+    std::unordered_map<unsigned int, std::vector<int>> uniformLocations;
+    int uniformBufferAlignment = 256;
+    std::vector<Material> materials;
+    std::vector<MaterialUniforms> materialUniforms;
+    std::vector<uint32_t> materialStateKeys;
+    std::unordered_map<std::string, MaterialHandle> materialHandles;
+    std::vector<unsigned int> shaderSlots;
+    std::vector<unsigned int> textureSlots;
+    FrameArena arena;
+    std::vector<Bucket> buckets;
+    std::unordered_map<BucketKey, uint32_t, BucketKeyHash> bucketIds;
+    std::vector<DrawItem> drawItems;
+    std::vector<DrawItem> sortScratch;
+    uint32_t activeBucket = NoBucket;
     int activeLayer = 0;
     float activeSubLayer = 0;
-    Material activeMaterial = {};
+    MaterialHandle activeMaterial = NoMaterial;
     Camera* activeCamera = nullptr;
     Framebuffer activeFramebuffer = {};
+    StreamBuffer stream;
+    GpuTimers gpuTimers;
+    unsigned int streamVAO = 0;
+    unsigned int spriteVAO = 0;
 };
 
+/// Creates the buffers shared by all frames, call once after the GL context is current
+void initialize();
+/// Fences the data streamed this frame, call once per frame after the last flush
+void endFrame();
+/// Bytes of vertex and uniform data written into the stream buffer so far
+uint64_t streamedBytes();
+
+/// GPU time of the draws of one layer and material during a frame
+using GpuTiming = GpuTimers::Timing;
+/// Times the draws of each layer and material on the GPU, off by default. Leave it off where GL has no timer queries.
+void setGpuTimingEnabled(bool enabled);
+/// GPU timings of the latest frame whose queries completed, GpuTimers::FrameCount frames behind
+const std::vector<GpuTiming>& gpuTimings();
+
+UniformId internUniform(const std::string& name);
+/// Caches the locations of the active uniforms of shader and binds its Camera block, createShaderProgram calls it
+void reflectShader(unsigned int shader);
+/// Location of uniform in shader from the reflection cache, -1 when the shader has no such uniform
+int uniformLocation(unsigned int shader, UniformId uniform);
+
 void setLayer(int layer);
 void setSubLayer(float subLayer);
-void setMaterial(const Material& material);
+/// Stores material for drawing and returns its handle. Registering a name again replaces that material and keeps its handle.
+/// Returns NoMaterial when the material, its shader or its texture would not fit the bits of the draw sort key.
+MaterialHandle registerMaterial(const Material& material);
+const Material& getMaterial(MaterialHandle material);
+void setMaterial(MaterialHandle material);
 void setCamera(Camera* camera);
 Framebuffer createFramebuffer(const glm::ivec2& resolution);
 void setFramebuffer(const Framebuffer& framebuffer);
 void unsetFramebuffer();
 void queue(const std::vector<glm::vec2>& newPositions);
 void queue(const std::vector<glm::vec2>& newPositions, const std::vector<glm::vec2>& newTexCoords);
+void queueStatic(const StaticMesh& mesh);
+void queueSprite(const glm::vec2& position, const glm::vec2& size, const glm::vec4& uvRect = {0.f, 0.f, 1.f, 1.f});
 void printGLDebug(const std::string& message);
 void flush();
 
 }
+
+/// Queues text with a material whose shader draws sprites
+void renderText(const std::string& text, BMFont& font, Render::MaterialHandle material);
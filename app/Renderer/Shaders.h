@@ -4,6 +4,8 @@
 #include <fstream>
 #include <sstream>
 
+#include "Renderer/Renderer.h"
+
 [[nodiscard]] unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource)
 {
     unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -23,6 +25,7 @@
 
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+    Render::reflectShader(shaderProgram);
     return shaderProgram;
 }
 
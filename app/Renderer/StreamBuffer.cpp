@@ -0,0 +1,96 @@
+#include "Renderer/StreamBuffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    constexpr GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+void StreamBuffer::create(size_t regionSize)
+{
+    m_regionSize = regionSize;
+    m_region = 0;
+    m_offset = 0;
+    glCreateBuffers(1, &m_buffer);
+    glNamedBufferStorage(m_buffer, m_regionSize * FrameCount, nullptr, mapFlags);
+    m_mapped = static_cast<std::byte*>(glMapNamedBufferRange(m_buffer, 0, m_regionSize * FrameCount, mapFlags));
+    if (!m_mapped)
+    {
+        std::cerr << "Failed to map stream buffer" << std::endl;
+    }
+}
+
+void StreamBuffer::reserve(size_t size)
+{
+    if (m_offset + size > m_regionSize)
+    {
+        grow(std::max(2 * m_regionSize, size));
+    }
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(size_t size, size_t alignment)
+{
+    auto aligned = (m_offset + alignment - 1) / alignment * alignment;
+    if (aligned + size > m_regionSize)
+    {
+        grow(std::max(2 * m_regionSize, size + alignment));
+        aligned = 0;
+    }
+    m_offset = aligned + size;
+    m_bytesAllocated += size;
+    auto offset = m_region * m_regionSize + aligned;
+    return {m_mapped + offset, offset};
+}
+
+void StreamBuffer::endFrame()
+{
+    if (m_fences[m_region])
+    {
+        glDeleteSync(m_fences[m_region]);
+    }
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_region = (m_region + 1) % FrameCount;
+    m_offset = 0;
+    wait(m_region);
+}
+
+unsigned int StreamBuffer::handle() const
+{
+    return m_buffer;
+}
+
+uint64_t StreamBuffer::bytesAllocated() const
+{
+    return m_bytesAllocated;
+}
+
+void StreamBuffer::wait(size_t region)
+{
+    auto fence = m_fences[region];
+    if (!fence)
+    {
+        return;
+    }
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000) == GL_TIMEOUT_EXPIRED)
+    {
+    }
+    glDeleteSync(fence);
+    m_fences[region] = nullptr;
+}
+
+void StreamBuffer::grow(size_t minimumRegionSize)
+{
+    std::cerr << "Growing stream buffer regions to " << minimumRegionSize << " bytes" << std::endl;
+    // Draws already issued keep the old storage alive until the GPU is done with them
+    glDeleteBuffers(1, &m_buffer);
+    for (auto& fence : m_fences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    create(minimumRegionSize);
+}
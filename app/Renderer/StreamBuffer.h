@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+
+/// Persistently mapped GL buffer that per frame vertex data is written into directly.
+/// The storage is split in FrameCount regions used round robin, one per frame in flight. endFrame fences the
+/// region the frame wrote and a region is only reused once its fence signalled, so writes never touch memory the
+/// GPU still reads and the storage is never orphaned. A frame that outgrows its region doubles the buffer.
+class StreamBuffer
+{
+public:
+    static constexpr size_t FrameCount = 3;
+
+    struct Allocation
+    {
+        std::byte* data = nullptr;
+        size_t offset = 0;
+    };
+
+    /// Allocates and maps the storage, needs a current GL context
+    void create(size_t regionSize);
+
+    /// Makes sure the next allocations totalling size bytes, alignment padding included, fit the current region.
+    /// Growing replaces the buffer and so drops bindings of it, reserve before binding anything allocated afterwards.
+    void reserve(size_t size);
+
+    /// Reserves size bytes in the region of the current frame, offset is relative to the start of handle()
+    Allocation allocate(size_t size, size_t alignment);
+
+    /// Fences the current region and moves on to the next one, waiting until the GPU is done with it
+    void endFrame();
+
+    unsigned int handle() const;
+
+    /// Bytes handed out by allocate so far, growing the buffer keeps the count
+    uint64_t bytesAllocated() const;
+
+private:
+    void wait(size_t region);
+    void grow(size_t minimumRegionSize);
+
+    unsigned int m_buffer = 0;
+    std::byte* m_mapped = nullptr;
+    size_t m_regionSize = 0;
+    size_t m_region = 0;
+    size_t m_offset = 0;
+    uint64_t m_bytesAllocated = 0;
+    std::array<GLsync, FrameCount> m_fences {};
+};
@@ -1,6 +1,7 @@
 #include "Renderer/Textures.h"
 
 #include <glad/glad.h>
+#include <algorithm>
 #include <iostream>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -34,3 +35,66 @@ bool loadTexture(const std::string& path, unsigned int& texture, TEXTURE_FILTER
     stbi_image_free(data);
     return true;
 }
+
+bool loadTextureArrays(const std::vector<std::string>& paths, std::vector<unsigned int>& textures, std::vector<TextureArrayLayer>& layers, TEXTURE_FILTER filter)
+{
+    struct Image
+    {
+        unsigned char* data;
+        glm::ivec2 size;
+    };
+    std::vector<Image> images;
+    stbi_set_flip_vertically_on_load(true);
+    for (auto& path : paths)
+    {
+        int width, height, nrChannels;
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 4);
+        if (!data)
+        {
+            std::cerr << "Failed to load texture " << path << std::endl;
+            for (auto& image : images)
+            {
+                stbi_image_free(image.data);
+            }
+            return false;
+        }
+        images.push_back({data, {width, height}});
+    }
+
+    // Only images of the same size share an array, so every layer is filled and wraps like a texture of its own
+    std::vector<glm::ivec2> sizes;
+    std::vector<int> layerCounts;
+    layers.clear();
+    for (auto& image : images)
+    {
+        auto found = std::find(sizes.begin(), sizes.end(), image.size);
+        if (found == sizes.end())
+        {
+            sizes.push_back(image.size);
+            layerCounts.push_back(0);
+            found = sizes.end() - 1;
+        }
+        auto array = static_cast<size_t>(found - sizes.begin());
+        layers.push_back({array, layerCounts[array]++});
+    }
+
+    textures.resize(sizes.size());
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, textures.size(), textures.data());
+    for (size_t array = 0; array < textures.size(); array++)
+    {
+        auto texture = textures[array];
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, filter == TEXTURE_FILTER::NEAREST ? GL_NEAREST : GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, filter == TEXTURE_FILTER::NEAREST ? GL_NEAREST : GL_LINEAR);
+        // The min filter never samples mipmaps, so the arrays only have the base level
+        glTextureStorage3D(texture, 1, GL_RGBA8, sizes[array].x, sizes[array].y, layerCounts[array]);
+    }
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        auto& image = images[i];
+        glTextureSubImage3D(textures[layers[i].array], 0, 0, 0, layers[i].layer, image.size.x, image.size.y, 1, GL_RGBA, GL_UNSIGNED_BYTE, image.data);
+        stbi_image_free(image.data);
+    }
+    return true;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 #include <glm/glm.hpp>
@@ -12,6 +13,23 @@ enum TEXTURE_FILTER
 
 bool loadTexture(const std::string& path, unsigned int& texture, TEXTURE_FILTER filter);
 
+/// Where an image ended up among texture arrays: the array holding the images of its size, and its layer in that array
+struct TextureArrayLayer
+{
+    size_t array;
+    int layer;
+};
+
+/// GL_TEXTURE_2D_ARRAYs with one array per image size, so draws using any of the images of a size can be batched into one
+struct TextureArrays
+{
+    std::vector<unsigned int> textures;
+    std::map<std::string, TextureArrayLayer> layers;
+};
+
+/// Loads the images at paths into texture arrays. Images of the same size share an array and fill its layers in order.
+bool loadTextureArrays(const std::vector<std::string>& paths, std::vector<unsigned int>& textures, std::vector<TextureArrayLayer>& layers, TEXTURE_FILTER filter);
+
 struct TextureRegion {
     glm::vec2 bottomLeft;
     glm::vec2 size;
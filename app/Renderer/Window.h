@@ -1,9 +1,34 @@
 #ifndef WINDOW_H
 #define WINDOW_H
 
+#include <string_view>
 #include <glm/glm.hpp>
 #include <GLFW/glfw3.h>
 
+#include "Renderer/NullBackend.h"
+
+/// Where frames go. Software and Null need no display and run on the GLFW null platform:
+/// Software renders offscreen through OSMesa (llvmpipe), Null loads the NullBackend stubs instead of a driver.
+enum class Backend
+{
+    Window,
+    Software,
+    Null
+};
+
+[[nodiscard]] bool parseBackend(std::string_view name, Backend& backend)
+{
+    if (name == "window")
+        backend = Backend::Window;
+    else if (name == "software")
+        backend = Backend::Software;
+    else if (name == "null")
+        backend = Backend::Null;
+    else
+        return false;
+    return true;
+}
+
 bool windowSizeChangeHandled = false;
 glm::ivec2 windowSize;
 
@@ -23,12 +48,31 @@ void processInput(GLFWwindow* window)
     }
 }
 
-[[nodiscard]] GLFWwindow* initializeOpenGLAndCreateWindow()
+[[nodiscard]] GLFWwindow* initializeOpenGLAndCreateWindow(Backend backend = Backend::Window)
 {
-    glfwInit();
+    if (backend != Backend::Window)
+    {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+    if (!glfwInit())
+    {
+        std::cout << "Failed to initialize GLFW" << std::endl;
+        return nullptr;
+    }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (backend == Backend::Software)
+    {
+        // llvmpipe stops at 4.5, which is all the renderer uses
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    }
+    else if (backend == Backend::Null)
+    {
+        // The window only provides input and timing, GL comes from the NullBackend
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    }
     
     GLFWwindow* window = glfwCreateWindow(1920, 1080, "Wood cutting", nullptr, nullptr);
     if (window == nullptr)
@@ -37,9 +81,20 @@ void processInput(GLFWwindow* window)
         glfwTerminate();
         return nullptr;
     }
-    glfwMakeContextCurrent(window);
+    glfwGetFramebufferSize(window, &windowSize.x, &windowSize.y);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
+    if (backend == Backend::Null)
+    {
+        if (!NullBackend::load())
+        {
+            std::cout << "Failed to initialize the null GL backend" << std::endl;
+            return nullptr;
+        }
+        return window;
+    }
+
+    glfwMakeContextCurrent(window);
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
         std::cout << "Failed to initialize GLAD" << std:: endl;
@@ -0,0 +1,161 @@
+#include "Tilemap.h"
+
+#include <algorithm>
+#include <bit>
+
+glm::ivec2 Tilemap::chunkCoordinate(const glm::ivec2 &position)
+{
+    // Floor division, so negative positions land in the chunk left of or below the origin
+    auto floorDivide = [](int value) { return value >= 0 ? value / TileChunkSize : (value + 1) / TileChunkSize - 1; };
+    return {floorDivide(position.x), floorDivide(position.y)};
+}
+
+int Tilemap::cellIndex(const glm::ivec2 &position)
+{
+    auto local = position - chunkCoordinate(position) * TileChunkSize;
+    return local.y * TileChunkSize + local.x;
+}
+
+const TileChunk *Tilemap::findChunk(const glm::ivec2 &position) const
+{
+    auto coordinate = chunkCoordinate(position) - m_chunkOrigin;
+    if (coordinate.x < 0 || coordinate.y < 0 || coordinate.x >= m_chunkCount.x || coordinate.y >= m_chunkCount.y)
+    {
+        return nullptr;
+    }
+    return m_chunks[static_cast<size_t>(coordinate.y) * m_chunkCount.x + coordinate.x].get();
+}
+
+void Tilemap::grow(const glm::ivec2 &minimumCoordinate, const glm::ivec2 &maximumCoordinate)
+{
+    auto minimum = m_chunks.empty() ? minimumCoordinate : glm::ivec2 {std::min(m_chunkOrigin.x, minimumCoordinate.x), std::min(m_chunkOrigin.y, minimumCoordinate.y)};
+    auto maximum = m_chunks.empty() ? maximumCoordinate + glm::ivec2 {1, 1} : glm::ivec2 {std::max(m_chunkOrigin.x + m_chunkCount.x, maximumCoordinate.x + 1), std::max(m_chunkOrigin.y + m_chunkCount.y, maximumCoordinate.y + 1)};
+    auto count = maximum - minimum;
+    if (minimum == m_chunkOrigin && count == m_chunkCount)
+    {
+        return;
+    }
+    std::vector<std::unique_ptr<TileChunk>> chunks(static_cast<size_t>(count.x) * count.y);
+    for (int y = 0; y < m_chunkCount.y; y++)
+    {
+        for (int x = 0; x < m_chunkCount.x; x++)
+        {
+            auto target = m_chunkOrigin + glm::ivec2 {x, y} - minimum;
+            chunks[static_cast<size_t>(target.y) * count.x + target.x] = std::move(m_chunks[static_cast<size_t>(y) * m_chunkCount.x + x]);
+        }
+    }
+    m_chunks = std::move(chunks);
+    m_chunkOrigin = minimum;
+    m_chunkCount = count;
+}
+
+TileChunk &Tilemap::chunk(const glm::ivec2 &position)
+{
+    auto coordinate = chunkCoordinate(position);
+    auto relative = coordinate - m_chunkOrigin;
+    if (m_chunks.empty() || relative.x < 0 || relative.y < 0 || relative.x >= m_chunkCount.x || relative.y >= m_chunkCount.y)
+    {
+        grow(coordinate, coordinate);
+        relative = coordinate - m_chunkOrigin;
+    }
+    auto &slot = m_chunks[static_cast<size_t>(relative.y) * m_chunkCount.x + relative.x];
+    if (!slot)
+    {
+        slot = std::make_unique<TileChunk>();
+    }
+    return *slot;
+}
+
+TileType Tilemap::type(const glm::ivec2 &position) const
+{
+    auto found = findChunk(position);
+    return found ? found->types[cellIndex(position)] : TileType::UNSET;
+}
+
+void Tilemap::setType(const glm::ivec2 &position, TileType type)
+{
+    if (type == TileType::UNSET && !findChunk(position))
+    {
+        return;
+    }
+    auto &found = chunk(position);
+    auto &cell = found.types[cellIndex(position)];
+    if (cell != type)
+    {
+        cell = type;
+        found.revision++;
+    }
+}
+
+bool Tilemap::blocked(const glm::ivec2 &position) const
+{
+    auto found = findChunk(position);
+    return found && found->blocked.test(cellIndex(position));
+}
+
+void Tilemap::setBlocked(const glm::ivec2 &position, bool blocked)
+{
+    if (!blocked && !findChunk(position))
+    {
+        return;
+    }
+    chunk(position).blocked.set(cellIndex(position), blocked);
+}
+
+size_t Tilemap::size() const
+{
+    size_t count = 0;
+    for (auto &found : m_chunks)
+    {
+        if (found)
+        {
+            count += std::count_if(found->types.begin(), found->types.end(), [](TileType type) { return type != TileType::UNSET; });
+        }
+    }
+    return count;
+}
+
+void Tilemap::clear()
+{
+    for (auto &found : m_chunks)
+    {
+        if (found)
+        {
+            auto revision = found->revision;
+            *found = TileChunk {};
+            found->revision = revision + 1;
+        }
+    }
+}
+
+void Tilemap::fill(TileType type)
+{
+    for (auto &found : m_chunks)
+    {
+        if (found)
+        {
+            std::replace_if(found->types.begin(), found->types.end(), [](TileType cell) { return cell != TileType::UNSET; }, type);
+            found->revision++;
+        }
+    }
+}
+
+void Tilemap::reserve(const glm::ivec2 &minimum, const glm::ivec2 &maximum)
+{
+    grow(chunkCoordinate(minimum), chunkCoordinate(maximum));
+}
+
+void Tilemap::setChunk(const glm::ivec2 &chunkOrigin, std::span<const TileType, TileChunkArea> types, std::span<const uint64_t, TileChunkArea / 64> blocked)
+{
+    auto &target = chunk(chunkOrigin);
+    std::copy(types.begin(), types.end(), target.types.begin());
+    target.blocked.reset();
+    for (size_t word = 0; word < blocked.size(); word++)
+    {
+        for (auto bits = blocked[word]; bits != 0; bits &= bits - 1)
+        {
+            target.blocked.set(word * 64 + std::countr_zero(bits));
+        }
+    }
+    target.revision++;
+}
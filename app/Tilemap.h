@@ -0,0 +1,175 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+enum class TileType : uint8_t
+{
+    UNSET = 0,
+    WATER,
+    GRASS,
+    PATH,
+    PATH_MINERAL_1,
+    PATH_MINERAL_2,
+    PATH_MINERAL_3,
+    GRASS_WATER_N,
+    GRASS_WATER_NE,
+    GRASS_WATER_E,
+    GRASS_WATER_SE,
+    GRASS_WATER_S,
+    GRASS_WATER_SW,
+    GRASS_WATER_W,
+    GRASS_WATER_NW,
+    GRASS_PATH_N,
+    GRASS_PATH_NE,
+    GRASS_PATH_E,
+    GRASS_PATH_SE,
+    GRASS_PATH_S,
+    GRASS_PATH_SW,
+    GRASS_PATH_W,
+    GRASS_PATH_NW,
+    PATH_GRASS_N,
+    PATH_GRASS_NE,
+    PATH_GRASS_E,
+    PATH_GRASS_SE,
+    PATH_GRASS_S,
+    PATH_GRASS_SW,
+    PATH_GRASS_W,
+    PATH_GRASS_NW,
+    PATH_WATER_N,
+    PATH_WATER_NE,
+    PATH_WATER_E,
+    PATH_WATER_SE,
+    PATH_WATER_S,
+    PATH_WATER_SW,
+    PATH_WATER_W,
+    PATH_WATER_NW,
+    WATER_GRASS_N,
+    WATER_GRASS_NE,
+    WATER_GRASS_E,
+    WATER_GRASS_SE,
+    WATER_GRASS_S,
+    WATER_GRASS_SW,
+    WATER_GRASS_W,
+    WATER_GRASS_NW,
+    WATER_PATH_N,
+    WATER_PATH_NE,
+    WATER_PATH_E,
+    WATER_PATH_SE,
+    WATER_PATH_S,
+    WATER_PATH_SW,
+    WATER_PATH_W,
+    WATER_PATH_NW,
+    CLAY,
+};
+
+/// Number of tile types, CLAY is the last one
+constexpr size_t TileTypeCount = static_cast<size_t>(TileType::CLAY) + 1;
+
+constexpr int TileChunkSize = 32;
+constexpr int TileChunkArea = TileChunkSize * TileChunkSize;
+
+/// Square block of tiles, a cell holding TileType::UNSET has no tile.
+/// The revision increases whenever a tile type in the chunk changes, so caches built from it can tell when they are stale.
+struct TileChunk
+{
+    std::array<TileType, TileChunkArea> types {};
+    std::bitset<TileChunkArea> blocked;
+    uint32_t revision = 0;
+};
+
+/// Ground layer of the level stored as a grid of chunks, one byte and one bit per tile.
+/// Chunks are allocated when a tile is first set in them, the chunk grid grows to cover new positions.
+/// Shared by the systems as a single resource instead of an entity per tile.
+class Tilemap
+{
+public:
+    TileType type(const glm::ivec2 &position) const;
+    void setType(const glm::ivec2 &position, TileType type);
+
+    bool blocked(const glm::ivec2 &position) const;
+    void setBlocked(const glm::ivec2 &position, bool blocked);
+
+    /// Returns the number of cells holding a tile
+    size_t size() const;
+
+    /// Removes all tiles, keeping the allocated chunks
+    void clear();
+
+    /// Sets every existing tile to type
+    void fill(TileType type);
+
+    /// Grows the chunk grid to cover the tiles from minimum to maximum, both inclusive, without allocating chunks.
+    /// Filling a large map after one reserve avoids regrowing the grid chunk by chunk.
+    void reserve(const glm::ivec2 &minimum, const glm::ivec2 &maximum);
+
+    /// Replaces the tiles of the chunk starting at chunkOrigin, blocked holds one bit per cell in 64 bit words
+    void setChunk(const glm::ivec2 &chunkOrigin, std::span<const TileType, TileChunkArea> types, std::span<const uint64_t, TileChunkArea / 64> blocked);
+
+    /// Calls function(position, type) for every tile
+    template <typename Function>
+    void each(Function function) const
+    {
+        forEachChunk([&](const glm::ivec2 &chunkOrigin, const TileChunk &chunk)
+        {
+            for (int cell = 0; cell < TileChunkArea; cell++)
+            {
+                if (chunk.types[cell] != TileType::UNSET)
+                {
+                    function(chunkOrigin + glm::ivec2 {cell % TileChunkSize, cell / TileChunkSize}, chunk.types[cell]);
+                }
+            }
+        });
+    }
+
+    /// Calls function(position, type) for every tile in the rectangle from minimum to maximum, both inclusive
+    template <typename Function>
+    void eachIn(const glm::ivec2 &minimum, const glm::ivec2 &maximum, Function function) const
+    {
+        auto first = glm::max(minimum, m_chunkOrigin * TileChunkSize);
+        auto last = glm::min(maximum, (m_chunkOrigin + m_chunkCount) * TileChunkSize - glm::ivec2 {1, 1});
+        for (int y = first.y; y <= last.y; y++)
+        {
+            for (int x = first.x; x <= last.x; x++)
+            {
+                auto tileType = type({x, y});
+                if (tileType != TileType::UNSET)
+                {
+                    function(glm::ivec2 {x, y}, tileType);
+                }
+            }
+        }
+    }
+
+    /// Calls function(chunkOrigin, chunk) for every allocated chunk, chunkOrigin is the position of its first tile
+    template <typename Function>
+    void forEachChunk(Function function) const
+    {
+        for (int y = 0; y < m_chunkCount.y; y++)
+        {
+            for (int x = 0; x < m_chunkCount.x; x++)
+            {
+                if (auto &chunk = m_chunks[static_cast<size_t>(y) * m_chunkCount.x + x])
+                {
+                    function((m_chunkOrigin + glm::ivec2 {x, y}) * TileChunkSize, *chunk);
+                }
+            }
+        }
+    }
+
+private:
+    const TileChunk *findChunk(const glm::ivec2 &position) const;
+    TileChunk &chunk(const glm::ivec2 &position);
+    void grow(const glm::ivec2 &minimumCoordinate, const glm::ivec2 &maximumCoordinate);
+    static glm::ivec2 chunkCoordinate(const glm::ivec2 &position);
+    static int cellIndex(const glm::ivec2 &position);
+
+    glm::ivec2 m_chunkOrigin {0, 0};
+    glm::ivec2 m_chunkCount {0, 0};
+    std::vector<std::unique_ptr<TileChunk>> m_chunks;
+};
@@ -2,10 +2,13 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
+#include <iomanip>
+#include <sstream>
 
 #include "Platform.h"
 #include "Renderer/Renderer.h"
 #include "ECS/ECS.h"
+#include "ECS/Scheduler.h"
 #include "ECS/Systems/Systems.h"
 #include "ECS/Systems/InputSystem.h"
 #include "Renderer/Shaders.h"
@@ -15,38 +18,61 @@
 #include "Catalog.h"
 #include "FontRendering/BMFont.h"
 #include "Imgui/Imgui.h"
-
-void createFBO(unsigned int &fbo, unsigned int &fboBuffer) {
-    glGenFramebuffers(1, &fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-    glGenTextures(1, &fboTexture);
-    glBindTexture(GL_TEXTURE_2D, fboTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, VIRTUAL_WIDTH, VIRTUAL_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fboTexture, 0);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cerr << "Framebuffer not complete!\n";
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
+#include "Jobs/ThreadPool.h"
+#include "Profiler/Profiler.h"
 
 int main(int argc, char *argv[])
 {
+    // --backend=window|software|null picks where frames go, --frames=N quits after N frames.
+    // The headless backends stop after 600 frames unless told otherwise and print frame statistics on exit.
+    // --trace=file writes the profiler zones of the last frames on exit, F3 writes them to profile.json any time.
+    // --convert-level=file rewrites a level saved in the old stream format into the level file and quits.
+    auto backend = Backend::Window;
+    int frameLimit = 0;
+    std::string tracePath;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--backend="))
+        {
+            if (!parseBackend(arg.substr(10), backend))
+            {
+                std::cerr << "Unknown backend " << arg.substr(10) << std::endl;
+                return -1;
+            }
+        }
+        else if (arg.starts_with("--frames="))
+        {
+            frameLimit = std::stoi(std::string(arg.substr(9)));
+        }
+        else if (arg.starts_with("--trace="))
+        {
+            tracePath = arg.substr(8);
+        }
+        else if (arg.starts_with("--convert-level="))
+        {
+            return convertLegacyLevel(arg.substr(16)) ? 0 : -1;
+        }
+    }
+    if (backend != Backend::Window && frameLimit == 0)
+    {
+        frameLimit = 600;
+    }
+
     glfwWindowHint(GLFW_SAMPLES, 4);
 
-    auto window = initializeOpenGLAndCreateWindow();
+    auto window = initializeOpenGLAndCreateWindow(backend);
 
     if (not window)
         return -1;
 
     glfwSetKeyCallback(window, keyCallback);
+    Render::initialize();
+    // The null backend has no timer queries
+    Render::setGpuTimingEnabled(backend != Backend::Null);
 
     auto textureCatalog = createTextureCatalog("assets/textures", TEXTURE_FILTER::LINEAR);
+    auto terrainTextures = createTextureArrays("assets/textures", terrainTextureNames(), TEXTURE_FILTER::LINEAR);
     auto animationCatalog = createAnimationCatalog("assets/textures");
     auto fontTextureCatalog = createTextureCatalog("assets/fonts", TEXTURE_FILTER::LINEAR);
     auto font = loadBMFont("assets/fonts/ComicSans80/ComicSans80.fnt");
@@ -55,9 +81,15 @@ int main(int argc, char *argv[])
     auto unlitColorFragment = readFile("assets/shaders/unlit-color/fragment.glsl");
     auto unlitTextureVertex = readFile("assets/shaders/unlit-texture/vertex.glsl");
     auto unlitTextureFragment = readFile("assets/shaders/unlit-texture/fragment.glsl");
+    auto spriteVertex = readFile("assets/shaders/sprite/vertex.glsl");
+    auto terrainVertex = readFile("assets/shaders/unlit-texture-array/vertex.glsl");
+    auto terrainFragment = readFile("assets/shaders/unlit-texture-array/fragment.glsl");
 
     auto unlitColorShader = createShaderProgram(unlitColorVertex.c_str(), unlitColorFragment.c_str());
     auto unlitTextureShader = createShaderProgram(unlitTextureVertex.c_str(), unlitTextureFragment.c_str());
+    auto spriteColorShader = createShaderProgram(spriteVertex.c_str(), unlitColorFragment.c_str());
+    auto spriteTextureShader = createShaderProgram(spriteVertex.c_str(), unlitTextureFragment.c_str());
+    auto terrainShader = createShaderProgram(terrainVertex.c_str(), terrainFragment.c_str());
 
     BufferData tileBuffer = bufferData(createRectangleVertices(1.f, 1.f));
     BufferData tileTexBuffer = bufferData({{0.0, 0.0}, {1.0, 0.0}, {1.0, 1.0}, {0.1, 1.0}});
@@ -82,19 +114,25 @@ int main(int argc, char *argv[])
     GameState gameState;
     gameState.mission = Missions::START;
 
-    TileSystem tileSystem { gameState, textureCatalog };
-    tileSystem.unlitTextureShader = unlitTextureShader;
+    Registry registry;
+    ThreadPool threadPool;
+    SpatialGrid grid { registry };
+    Tilemap tilemap;
+
+    TileSystem tileSystem { gameState, tilemap, grid, textureCatalog };
+    tileSystem.terrainTextures = &terrainTextures;
+    tileSystem.terrainShader = terrainShader;
+    tileSystem.spriteShader = spriteTextureShader;
     tileSystem.posBuffer = tileBuffer.handle;
     tileSystem.texBuffer = tileTexBuffer.handle;
     tileSystem.tileRenderData = tileRenderData;
     tileSystem.camera = &sceneCamera;
 
-    TileEditingSystem tileEditingSystem { gameState };
+    TileEditingSystem tileEditingSystem { gameState, tilemap, grid };
     tileEditingSystem.unlitColorShader = unlitColorShader;
     tileEditingSystem.lineRenderData = tileLineRenderData;
     tileEditingSystem.camera = &sceneCamera;
 
-    Registry registry;
     Entity tink = registry.create();
     Entity george = registry.create();
     Entity oven = registry.create();
@@ -107,14 +145,14 @@ int main(int argc, char *argv[])
     registry.insert<glm::ivec2>(oven, {30, 30});
     registry.insert<AnimationState>(tink, { "Cute_Fantasy_Free/Player/RunDown", 0 });
 
-    MovementSystem movementSystem { gameState };
+    MovementSystem movementSystem { gameState, tilemap };
     movementSystem.tink = tink;
     movementSystem.camera = &sceneCamera;
-    WoodGatheringSystem woodGatheringSystem{tink, gameState};
-    ClayGatheringSystem clayGatheringSystem{tink, gameState};
-    GlazeGatheringSystem glazeGatheringSystem{tink, gameState};
+    WoodGatheringSystem woodGatheringSystem{tink, gameState, threadPool};
+    ClayGatheringSystem clayGatheringSystem{tink, gameState, tilemap};
+    GlazeGatheringSystem glazeGatheringSystem{tink, gameState, threadPool};
     DialogSystem dialogSystem { font, fontTextureCatalog };
-    dialogSystem.unlitTextureShader = unlitTextureShader;
+    dialogSystem.spriteShader = spriteTextureShader;
     dialogSystem.charTexBuffer = charTexBuffer.handle;
     dialogSystem.charRenderData = charRenderData;
     dialogSystem.camera = &uiCamera;
@@ -123,29 +161,44 @@ int main(int argc, char *argv[])
     missionSystem.george = george;
     missionSystem.oven = oven;
 
-    AnimationSystem animationSystem { animationCatalog };
+    AnimationSystem animationSystem { animationCatalog, threadPool };
     
-    loadLevel(registry);
+    loadLevel(registry, tilemap);
+
+    Scheduler scheduler { threadPool };
+    scheduler.add<Reads<Tilemap, GameState>, Writes<Pos, Render::Camera>>("Movement", [&](float deltaTime) { movementSystem.run(registry, deltaTime); });
+    scheduler.add<Reads<Pos, glm::ivec2, DecoType>, Writes<GameState>>("WoodGathering", [&](float deltaTime) { woodGatheringSystem.run(registry, deltaTime); });
+    scheduler.add<Reads<Pos>, Writes<Tilemap, GameState>>("ClayGathering", [&](float deltaTime) { clayGatheringSystem.run(registry, deltaTime); });
+    scheduler.add<Reads<Pos, glm::ivec2, DecoType>, Writes<GameState>>("GlazeGathering", [&](float deltaTime) { glazeGatheringSystem.run(registry, deltaTime); });
+    scheduler.add<Reads<Pos, glm::ivec2>, Writes<GameState, DialogSystem>>("Mission", [&](float deltaTime) { missionSystem.run(registry, deltaTime); });
+    scheduler.add<Reads<>, Writes<AnimationState>>("Animation", [&](float deltaTime) { animationSystem.run(registry, deltaTime); });
 
     Imgui::installCallbacks(window);
+    Imgui::setFont(&font, getTexture(fontTextureCatalog, "ComicSans80/ComicSans80_0.png"));
     
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_MULTISAMPLE);
 
-    glfwSwapInterval(0);
+    if (backend != Backend::Null)
+    {
+        glfwSwapInterval(0);
+    }
     auto previousFrame = 0.f;
-    
-    unsigned int fbo, fboTexture;
-    createFBO(fbo, fboTexture);
+    auto firstFrame = glfwGetTime();
+    int frameCount = 0;
 
-    while (!glfwWindowShouldClose(window))
+    while (!glfwWindowShouldClose(window) && (frameLimit == 0 || frameCount < frameLimit))
     {
         glfwPollEvents();
         auto currentFrame = glfwGetTime();
         auto timeDelta = currentFrame - previousFrame;
         previousFrame = currentFrame;
         processInput(window);
+        if (isPressed(GLFW_KEY_F3))
+        {
+            Profiler::writeChromeTrace("profile.json");
+        }
 
         if (not windowSizeChangeHandled)
         {
@@ -155,24 +208,32 @@ int main(int argc, char *argv[])
         }
 
         // Game systems
-        movementSystem.run(registry, timeDelta);
-        woodGatheringSystem.run(registry, timeDelta);
-        clayGatheringSystem.run(registry, timeDelta);
-        glazeGatheringSystem.run(registry, timeDelta);
-        missionSystem.run(registry, timeDelta);
-        animationSystem.run(registry, timeDelta);
+        scheduler.run(timeDelta);
+
+        // Sync point, apply structural changes recorded while iterating
+        woodGatheringSystem.commands.apply(registry);
+        glazeGatheringSystem.commands.apply(registry);
 
         // Render systems
         glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        tileSystem.run(registry, timeDelta);
-        tileEditingSystem.run(registry, timeDelta);
-        dialogSystem.run(registry, timeDelta);
+        {
+            PROFILE_ZONE("Tile");
+            tileSystem.run(registry, timeDelta);
+        }
+        {
+            PROFILE_ZONE("TileEditing");
+            tileEditingSystem.run(registry, timeDelta);
+        }
+        {
+            PROFILE_ZONE("Dialog");
+            dialogSystem.run(registry, timeDelta);
+        }
 
         markKeyStatesHold();
 
-        Imgui::begin(unlitColorShader, unlitTextureShader, tileRenderData, &uiCamera);
+        Imgui::begin(spriteColorShader, spriteTextureShader, tileRenderData, &uiCamera);
         Imgui::panelBegin("MyPanel", 10, 10, {Imgui::LayoutStyle::Column});
 
         if (Imgui::button("MyButton 1", 200, 100))
@@ -237,9 +298,57 @@ int main(int argc, char *argv[])
         }
 
         Imgui::panelEnd();
+
+#if PROFILER_ENABLED
+        Imgui::panelBegin("Profiler", 1500, 10, {Imgui::LayoutStyle::Column});
+        auto milliseconds = [](double value)
+        {
+            std::ostringstream text;
+            text << std::fixed << std::setprecision(2) << value << " ms";
+            return text.str();
+        };
+        Imgui::label("Frame " + milliseconds(Profiler::lastFrameMilliseconds()));
+        for (auto& zone : Profiler::lastFrame())
+        {
+            Imgui::label(std::string(2 * zone.depth, ' ') + zone.name + " " + milliseconds(zone.milliseconds));
+        }
+        for (auto& timing : Render::gpuTimings())
+        {
+            auto& material = Render::getMaterial(timing.material).name;
+            Imgui::label("GPU layer " + std::to_string(timing.layer) + " " + material + " " + milliseconds(timing.milliseconds));
+        }
+        Imgui::panelEnd();
+#endif
         Imgui::end();
 
-        glfwSwapBuffers(window);
+        Render::endFrame();
+        if (backend != Backend::Null)
+        {
+            glfwSwapBuffers(window);
+        }
+        frameCount++;
+        Profiler::frameMark();
+    }
+
+    if (not tracePath.empty())
+    {
+        Profiler::writeChromeTrace(tracePath);
+    }
+
+    if (backend != Backend::Window && frameCount > 0)
+    {
+        auto elapsed = glfwGetTime() - firstFrame;
+        std::cout << frameCount << " frames in " << elapsed << " s, " << 1000.0 * elapsed / frameCount << " ms per frame" << std::endl;
+        std::cout << "Streamed " << Render::streamedBytes() / frameCount << " bytes per frame" << std::endl;
+        if (backend == Backend::Null)
+        {
+            auto& stats = NullBackend::stats();
+            std::cout << "Per frame: " << stats.drawCalls / frameCount << " draw calls, "
+                      << stats.instances / frameCount << " instances, "
+                      << stats.vertices / frameCount << " vertices, "
+                      << stats.stateChanges / frameCount << " state changes" << std::endl;
+            std::cout << "Uploaded " << stats.bytesUploaded << " bytes in total" << std::endl;
+        }
     }
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aSize;
+layout (location = 2) in vec4 aUVRect;
+
+out vec2 TexCoord;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+};
+
+const vec2 corners[6] = vec2[6](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0));
+
+void main()
+{
+    vec2 corner = corners[gl_VertexID];
+    gl_Position = projection * view * vec4(aPos + corner * aSize, 0.0, 1.0);
+    TexCoord = mix(aUVRect.xy, aUVRect.zw, corner);
+}
@@ -1,7 +1,10 @@
 #version 330 core
 layout (location = 0) in vec2 aPos;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+};
 void main()
 {
     gl_Position = projection * view * vec4(aPos, 0.0, 1.0);
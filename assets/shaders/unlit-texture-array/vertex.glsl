@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec3 aTexCoord;
+
+out vec3 TexCoord;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+};
+
+void main()
+{
+    gl_Position = projection * view * vec4(aPos, 0.0, 1.0);
+	TexCoord = aTexCoord;
+}
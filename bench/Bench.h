@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <benchmark/benchmark.h>
+
+/// Entity counts every benchmark runs with, 1K to 1M in steps of ten
+inline void entityCounts(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->RangeMultiplier(10)->Range(1'000, 1'000'000);
+}
+
+/// Calls to the global operator new so far, from any thread. Benchmarks report differences as counters.
+uint64_t allocationCount();
+
+/// Silences std::cerr while alive, the loaders log every step and that output would be measured with them
+struct QuietLog
+{
+    QuietLog() : previous(std::cerr.rdbuf(nullptr))
+    {
+    }
+
+    ~QuietLog()
+    {
+        std::cerr.rdbuf(previous);
+    }
+
+    std::streambuf* previous;
+};
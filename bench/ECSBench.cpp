@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <random>
+
+#include "Bench.h"
+#include "ECS/ECS.h"
+
+namespace {
+    using Pos = glm::vec2;
+
+    struct Velocity
+    {
+        glm::vec2 value;
+    };
+
+    std::vector<Entity> entities(int64_t count)
+    {
+        std::vector<Entity> result(count);
+        for (int64_t i = 0; i < count; i++)
+        {
+            result[i] = makeEntity(i + 1, 0);
+        }
+        return result;
+    }
+
+    std::vector<Entity> shuffledEntities(int64_t count)
+    {
+        auto result = entities(count);
+        std::shuffle(result.begin(), result.end(), std::mt19937{42});
+        return result;
+    }
+
+    /// Every entity gets a position and every second one a velocity
+    void populate(Registry& registry, int64_t count)
+    {
+        for (int64_t i = 0; i < count; i++)
+        {
+            auto entity = registry.create();
+            registry.insert<glm::vec2>(entity, {float(i), 0.f});
+            if (i % 2 == 0)
+            {
+                registry.insert<Velocity>(entity, {{1.f, 1.f}});
+            }
+        }
+    }
+}
+
+static void BM_ComponentStorageInsert(benchmark::State& state)
+{
+    auto ids = entities(state.range(0));
+    for (auto _ : state)
+    {
+        ComponentStorage<glm::vec2> storage;
+        for (auto entity : ids)
+        {
+            storage.insert(entity, glm::vec2{1.f, 2.f});
+        }
+        benchmark::DoNotOptimize(storage.dense.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ComponentStorageInsert)->Apply(entityCounts);
+
+static void BM_ComponentStorageRemove(benchmark::State& state)
+{
+    auto ids = entities(state.range(0));
+    auto order = shuffledEntities(state.range(0));
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        ComponentStorage<glm::vec2> storage;
+        for (auto entity : ids)
+        {
+            storage.insert(entity, glm::vec2{1.f, 2.f});
+        }
+        state.ResumeTiming();
+        for (auto entity : order)
+        {
+            storage.remove(entity);
+        }
+        benchmark::DoNotOptimize(storage.dense.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ComponentStorageRemove)->Apply(entityCounts);
+
+static void BM_ComponentStorageGet(benchmark::State& state)
+{
+    ComponentStorage<glm::vec2> storage;
+    for (auto entity : entities(state.range(0)))
+    {
+        storage.insert(entity, glm::vec2{1.f, 2.f});
+    }
+    auto order = shuffledEntities(state.range(0));
+    for (auto _ : state)
+    {
+        glm::vec2 sum {0.f};
+        for (auto entity : order)
+        {
+            sum += storage.get(entity);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ComponentStorageGet)->Apply(entityCounts);
+
+/// Component lookups through the registry in random entity order, every get<Pos> resolves the storage first
+static void BM_RegistryGet(benchmark::State& state)
+{
+    Registry registry;
+    std::vector<Entity> order;
+    for (int64_t i = 0; i < state.range(0); i++)
+    {
+        auto entity = registry.create();
+        registry.insert<Pos>(entity, {float(i), 0.f});
+        order.push_back(entity);
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937{42});
+    for (auto _ : state)
+    {
+        Pos sum {0.f};
+        for (auto entity : order)
+        {
+            sum += registry.get<Pos>(entity);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RegistryGet)->Apply(entityCounts);
+
+/// The join walks the velocities and looks the positions up
+static void BM_RegistryEachJoin(benchmark::State& state)
+{
+    Registry registry;
+    populate(registry, state.range(0));
+    int64_t visited = 0;
+    for (auto _ : state)
+    {
+        for (auto [entity, pos, velocity] : registry.each<glm::vec2, Velocity>())
+        {
+            pos += velocity.value;
+            visited++;
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(visited);
+}
+BENCHMARK(BM_RegistryEachJoin)->Apply(entityCounts);
+
+/// Heap allocations of the same join, reported per pass. The view walks the storages in place, so it should be zero.
+static void BM_RegistryEachAllocations(benchmark::State& state)
+{
+    Registry registry;
+    populate(registry, state.range(0));
+    uint64_t allocations = 0;
+    for (auto _ : state)
+    {
+        auto before = allocationCount();
+        for (auto [entity, pos, velocity] : registry.each<glm::vec2, Velocity>())
+        {
+            pos += velocity.value;
+        }
+        allocations += allocationCount() - before;
+        benchmark::ClobberMemory();
+    }
+    state.counters["allocations"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_RegistryEachAllocations)->Apply(entityCounts);
+
+/// The same join over an owning group, a linear walk over the packed front of both storages
+static void BM_RegistryGroupJoin(benchmark::State& state)
+{
+    Registry registry;
+    populate(registry, state.range(0));
+    auto& group = registry.group<glm::vec2, Velocity>();
+    for (auto _ : state)
+    {
+        for (auto [entity, pos, velocity] : group)
+        {
+            pos += velocity.value;
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * group.size());
+}
+BENCHMARK(BM_RegistryGroupJoin)->Apply(entityCounts);
+
+/// A tenth of the velocities are removed and inserted again while a group owns the storages,
+/// every change swaps the entity out of or into the packed front
+static void BM_RegistryGroupChurn(benchmark::State& state)
+{
+    Registry registry;
+    populate(registry, state.range(0));
+    auto& group = registry.group<glm::vec2, Velocity>();
+    auto moving = registry.getEntities<Velocity>();
+    std::shuffle(moving.begin(), moving.end(), std::mt19937{42});
+    moving.resize(moving.size() / 10);
+    for (auto _ : state)
+    {
+        for (auto entity : moving)
+        {
+            registry.remove<Velocity>(entity);
+        }
+        for (auto entity : moving)
+        {
+            registry.insert<Velocity>(entity, {{1.f, 1.f}});
+        }
+        benchmark::DoNotOptimize(group.size());
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * moving.size());
+}
+BENCHMARK(BM_RegistryGroupChurn)->Apply(entityCounts);
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+#include "Bench.h"
+#include "Catalog.h"
+#include "ECS/Systems/Systems.h"
+#include "FontRendering/BMFont.h"
+#include "Tilemap.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    fs::path scratchPath(const std::string& name)
+    {
+        auto directory = fs::temp_directory_path() / "wood-cutting-bench";
+        fs::create_directories(directory);
+        return directory / name;
+    }
+}
+
+/// Level with count tiles in a square, every eighth tile blocked and a decoration on every fourth
+static void BM_LoadLevel(benchmark::State& state)
+{
+    QuietLog quiet;
+    auto count = state.range(0);
+    auto path = scratchPath("level-" + std::to_string(count) + ".dat");
+    {
+        Registry registry;
+        Tilemap tilemap;
+        int side = std::ceil(std::sqrt(double(count)));
+        for (int64_t i = 0; i < count; i++)
+        {
+            glm::ivec2 pos { int(i % side), int(i / side) };
+            tilemap.setType(pos, static_cast<TileType>(1 + i % int(TileType::CLAY)));
+            tilemap.setBlocked(pos, i % 8 == 0);
+            if (i % 4 == 0)
+            {
+                auto deco = registry.create();
+                registry.insert<glm::ivec2>(deco, pos);
+                registry.insert<DecoType>(deco, DecoType::FLOWER);
+            }
+        }
+        saveLevel(registry, tilemap, path);
+    }
+    for (auto _ : state)
+    {
+        Registry registry;
+        Tilemap tilemap;
+        loadLevel(registry, tilemap, path);
+        benchmark::DoNotOptimize(tilemap.size());
+    }
+    fs::remove(path);
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_LoadLevel)->Apply(entityCounts);
+
+/// Font file with count char lines, real fonts have about a hundred
+static void BM_LoadBMFont(benchmark::State& state)
+{
+    QuietLog quiet;
+    auto count = state.range(0);
+    auto path = scratchPath("font-" + std::to_string(count) + ".fnt");
+    {
+        std::ofstream font(path);
+        font << "info face=\"Bench\" size=-80 bold=1 italic=0 charset=\"\" unicode=1 stretchH=100 smooth=0 aa=1 padding=1,1,1,1 spacing=0,0 outline=0\n";
+        font << "common lineHeight=111 base=89 scaleW=512 scaleH=512 pages=1 packed=0 alphaChnl=0 redChnl=4 greenChnl=4 blueChnl=4\n";
+        font << "page id=0 file=\"Bench_0.png\"\n";
+        font << "chars count=" << count << "\n";
+        for (int64_t i = 0; i < count; i++)
+        {
+            font << "char id=" << 32 + i % 95 << "   x=" << i % 512 << "     y=" << i % 509
+                 << "     width=40    height=60    xoffset=0     yoffset=0     xadvance=35    page=0  chnl=15\n";
+        }
+    }
+    for (auto _ : state)
+    {
+        auto font = loadBMFont(path.string());
+        benchmark::DoNotOptimize(font.chars.size());
+    }
+    fs::remove(path);
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_LoadBMFont)->Apply(entityCounts);
+
+/// Atlas descriptor with count frames and an eight frame animation tag over each run of frames.
+/// Stops at 100K frames, the JSON document of a million frames alone takes gigabytes.
+static void BM_CreateAnimationCatalog(benchmark::State& state)
+{
+    QuietLog quiet;
+    auto count = state.range(0);
+    auto directory = scratchPath("atlas-" + std::to_string(count));
+    fs::create_directories(directory / "Bench");
+    {
+        std::ofstream atlas(directory / "Bench" / "Atlas.json");
+        atlas << "{\"frames\": [";
+        for (int64_t i = 0; i < count; i++)
+        {
+            atlas << (i > 0 ? "," : "") << "{\"frame\": {\"x\": " << 16 * (i % 64) << ", \"y\": " << 16 * (i / 64 % 64)
+                  << ", \"w\": 16, \"h\": 16}, \"duration\": 100}";
+        }
+        atlas << "], \"meta\": {\"image\": \"Bench/Atlas.png\", \"size\": {\"w\": 1024, \"h\": 1024}, \"frameTags\": [";
+        for (int64_t first = 0; first < count; first += 8)
+        {
+            atlas << (first > 0 ? "," : "") << "{\"name\": \"Tag" << first << "\", \"from\": " << first
+                  << ", \"to\": " << std::min(first + 7, count - 1) << "}";
+        }
+        atlas << "]}}";
+    }
+    for (auto _ : state)
+    {
+        auto catalog = createAnimationCatalog(directory);
+        benchmark::DoNotOptimize(catalog.size());
+    }
+    fs::remove_all(directory);
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_CreateAnimationCatalog)->RangeMultiplier(10)->Range(1'000, 100'000);
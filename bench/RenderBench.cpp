@@ -0,0 +1,85 @@
+#include <array>
+#include <string>
+
+#include "Bench.h"
+#include "Renderer/NullBackend.h"
+#include "Renderer/Renderer.h"
+
+namespace {
+    constexpr size_t MaterialCount = 8;
+    constexpr int LayerCount = 4;
+
+    /// Materials over two shaders and one texture each, the null backend hands any name back unchanged
+    const std::array<Render::MaterialHandle, MaterialCount>& materials()
+    {
+        static auto handles = []
+        {
+            std::array<Render::MaterialHandle, MaterialCount> result;
+            for (size_t i = 0; i < MaterialCount; i++)
+            {
+                Render::Material material;
+                material.name = "Bench " + std::to_string(i);
+                material.shader = 1 + i % 2;
+                material.texture = 1 + i;
+                result[i] = Render::registerMaterial(material);
+            }
+            return result;
+        }();
+        return handles;
+    }
+
+    Render::Camera camera { glm::vec2(0.f), glm::mat4(1.f), {640, 360} };
+
+    void reportDrawCalls(benchmark::State& state)
+    {
+        auto& stats = NullBackend::stats();
+        state.counters["drawCalls"] = benchmark::Counter(stats.drawCalls, benchmark::Counter::kAvgIterations);
+        state.counters["stateChanges"] = benchmark::Counter(stats.stateChanges, benchmark::Counter::kAvgIterations);
+    }
+}
+
+/// Sprites spread over every layer and material, the worst case for bucketing and sorting
+static void BM_RenderQueueSpritesFlush(benchmark::State& state)
+{
+    auto& handles = materials();
+    Render::setCamera(&camera);
+    NullBackend::resetStats();
+    for (auto _ : state)
+    {
+        for (int64_t i = 0; i < state.range(0); i++)
+        {
+            Render::setLayer(i % LayerCount);
+            Render::setMaterial(handles[i % MaterialCount]);
+            Render::queueSprite({float(i), 0.f}, {1.f, 1.f});
+        }
+        Render::flush();
+        Render::endFrame();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    reportDrawCalls(state);
+}
+BENCHMARK(BM_RenderQueueSpritesFlush)->Apply(entityCounts);
+
+/// Quads queued one by one as triangle vertices, the path text and shapes take
+static void BM_RenderQueueQuadsFlush(benchmark::State& state)
+{
+    auto& handles = materials();
+    std::vector<glm::vec2> positions { {0.f, 0.f}, {1.f, 0.f}, {1.f, 1.f}, {1.f, 1.f}, {0.f, 1.f}, {0.f, 0.f} };
+    std::vector<glm::vec2> texCoords = positions;
+    Render::setCamera(&camera);
+    NullBackend::resetStats();
+    for (auto _ : state)
+    {
+        for (int64_t i = 0; i < state.range(0); i++)
+        {
+            Render::setLayer(i % LayerCount);
+            Render::setMaterial(handles[i % MaterialCount]);
+            Render::queue(positions, texCoords);
+        }
+        Render::flush();
+        Render::endFrame();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    reportDrawCalls(state);
+}
+BENCHMARK(BM_RenderQueueQuadsFlush)->Apply(entityCounts);